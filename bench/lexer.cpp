@@ -0,0 +1,118 @@
+#include "lexer.h"
+
+#include <benchmark/benchmark.h>
+
+#include <fmt/format.h>
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lox
+{
+    namespace
+    {
+        std::string comment_heavy_source()
+        {
+            std::string source;
+            for (int i = 0; i < 500; ++i) {
+                source += "// ----------------------------------------------------------------------------\n";
+                source += "// This block documents the declaration below in great & tedious detail.\n";
+                source += "//     It is indented, wrapped and padded like hand written documentation.\n";
+                source += fmt::format("var value_{} = {};\n\n", i, i);
+            }
+            return source;
+        }
+
+        std::string data_table_source()
+        {
+            std::string source = "var table = nil;\n";
+            for (int i = 0; i < 2000; ++i) {
+                source += fmt::format("    print \"row {:>5} with a long descriptive label\";     print {}.5;\n", i, i);
+            }
+            return source;
+        }
+
+        std::string identifier_heavy_source()
+        {
+            std::string source;
+            for (int i = 0; i < 2000; ++i) {
+                source += fmt::format("var item_{0} = total and count_{0} or fallback; if (flag) print value_{0}; else return nil;\n", i);
+            }
+            return source;
+        }
+
+        std::vector<std::string_view> identifier_lexemes(const std::string& source)
+        {
+            std::vector<std::string_view> lexemes;
+            auto lexer = Lexer{source};
+            for (auto token = lexer.tokenize_next(); token.type != TokenType::Eof; token = lexer.tokenize_next()) {
+                if (token.type == TokenType::Identifier || Lexer::classify_identifier(lexer.lexeme(token)) != TokenType::Identifier) {
+                    lexemes.push_back(lexer.lexeme(token));
+                }
+            }
+            return lexemes;
+        }
+
+        void lex_all(benchmark::State& state, const std::string& source)
+        {
+            for (auto _ : state) {
+                auto lexer = Lexer{source};
+                std::size_t count = 0;
+                while (lexer.tokenize_next().type != TokenType::Eof) {
+                    ++count;
+                }
+                benchmark::DoNotOptimize(count);
+            }
+            state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * source.size()));
+        }
+
+        void BM_LexCommentHeavy(benchmark::State& state)
+        {
+            lex_all(state, comment_heavy_source());
+        }
+        BENCHMARK(BM_LexCommentHeavy);
+
+        void BM_LexDataTable(benchmark::State& state)
+        {
+            lex_all(state, data_table_source());
+        }
+        BENCHMARK(BM_LexDataTable);
+
+        void BM_LexIdentifierHeavy(benchmark::State& state)
+        {
+            lex_all(state, identifier_heavy_source());
+        }
+        BENCHMARK(BM_LexIdentifierHeavy);
+
+        // Reference for BM_KeywordPerfectHash: the hash map the lexer used to probe for every identifier
+        void BM_KeywordUnorderedMap(benchmark::State& state)
+        {
+            const auto keywords = std::unordered_map<std::string_view, TokenType>{Lexer::keywords.begin(), Lexer::keywords.end()};
+            const auto source = identifier_heavy_source();
+            const auto lexemes = identifier_lexemes(source);
+            for (auto _ : state) {
+                for (auto lexeme : lexemes) {
+                    const auto iter = keywords.find(lexeme);
+                    benchmark::DoNotOptimize(iter == keywords.end() ? TokenType::Identifier : iter->second);
+                }
+            }
+            state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * lexemes.size()));
+        }
+        BENCHMARK(BM_KeywordUnorderedMap);
+
+        void BM_KeywordPerfectHash(benchmark::State& state)
+        {
+            const auto source = identifier_heavy_source();
+            const auto lexemes = identifier_lexemes(source);
+            for (auto _ : state) {
+                for (auto lexeme : lexemes) {
+                    benchmark::DoNotOptimize(Lexer::classify_identifier(lexeme));
+                }
+            }
+            state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * lexemes.size()));
+        }
+        BENCHMARK(BM_KeywordPerfectHash);
+    } // namespace
+} // namespace lox
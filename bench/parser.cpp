@@ -0,0 +1,56 @@
+#include "lexer.h"
+#include "parser.h"
+
+#include <benchmark/benchmark.h>
+
+#include <fmt/format.h>
+
+#include <string>
+
+namespace lox
+{
+    namespace
+    {
+        // Both sources have the same shape, in the broken one every statement has a syntax error
+        std::string valid_source()
+        {
+            std::string source;
+            for (int i = 0; i < 2000; ++i) {
+                source += fmt::format("var value_{} = ({} + 1) * 2;\n", i, i);
+            }
+            return source;
+        }
+
+        std::string broken_source()
+        {
+            std::string source;
+            for (int i = 0; i < 2000; ++i) {
+                source += fmt::format("var value_{} = ({} + ) * 2;\n", i, i);
+            }
+            return source;
+        }
+
+        void parse_source(benchmark::State& state, const std::string& source)
+        {
+            for (auto _ : state) {
+                auto lexer = Lexer{source};
+                auto parser = Parser{lexer};
+                auto result = parser.parse();
+                benchmark::DoNotOptimize(result);
+            }
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+        }
+
+        void BM_ParseValid(benchmark::State& state)
+        {
+            parse_source(state, valid_source());
+        }
+        BENCHMARK(BM_ParseValid);
+
+        void BM_ParseBroken(benchmark::State& state)
+        {
+            parse_source(state, broken_source());
+        }
+        BENCHMARK(BM_ParseBroken);
+    } // namespace
+} // namespace lox
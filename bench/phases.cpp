@@ -0,0 +1,96 @@
+#include "bytecode_compiler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "vm.h"
+#include "workloads.h"
+
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+namespace lox
+{
+    namespace
+    {
+        void set_bytes_processed(benchmark::State& state, const std::string& source)
+        {
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * source.size()));
+        }
+
+        void BM_Lex(benchmark::State& state, const std::string& source)
+        {
+            for (auto _ : state) {
+                auto lexer = Lexer{source};
+                for (auto token = lexer.tokenize_next(); token.type != TokenType::Eof; token = lexer.tokenize_next()) {
+                    benchmark::DoNotOptimize(token);
+                }
+            }
+            set_bytes_processed(state, source);
+        }
+
+        // Lexing is included, tokens are streamed into the parser
+        void BM_Parse(benchmark::State& state, const std::string& source)
+        {
+            std::size_t ast_bytes = 0;
+            for (auto _ : state) {
+                auto lexer = Lexer{source};
+                auto parser = Parser{lexer};
+                auto result = parser.parse();
+                ast_bytes = result->memory_usage();
+                benchmark::DoNotOptimize(result);
+            }
+            set_bytes_processed(state, source);
+            state.counters["ast_bytes_per_source_byte"] = static_cast<double>(ast_bytes) / static_cast<double>(source.size());
+        }
+
+        void BM_Compile(benchmark::State& state, const std::string& source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto ast = parser.parse();
+            for (auto _ : state) {
+                auto compiler = BytecodeCompiler{};
+                auto output = compiler.compile(*ast);
+                benchmark::DoNotOptimize(output);
+            }
+            set_bytes_processed(state, source);
+        }
+
+        void BM_Execute(benchmark::State& state, const std::string& source)
+        {
+            const auto program = bench::compile(source);
+            auto vm = VM{};
+            for (auto _ : state) {
+                vm.execute(program);
+                state.PauseTiming();
+                vm.reset();
+                state.ResumeTiming();
+            }
+        }
+
+        void BM_EndToEnd(benchmark::State& state, const std::string& source)
+        {
+            for (auto _ : state) {
+                auto vm = VM{};
+                vm.execute(bench::compile(source));
+            }
+            set_bytes_processed(state, source);
+        }
+
+// Registers the per-phase & end-to-end benchmarks for bench::<workload>_source()
+#define LOX_BENCHMARK_WORKLOAD(workload)                                 \
+    BENCHMARK_CAPTURE(BM_Lex, workload, bench::workload##_source());     \
+    BENCHMARK_CAPTURE(BM_Parse, workload, bench::workload##_source());   \
+    BENCHMARK_CAPTURE(BM_Compile, workload, bench::workload##_source()); \
+    BENCHMARK_CAPTURE(BM_Execute, workload, bench::workload##_source()); \
+    BENCHMARK_CAPTURE(BM_EndToEnd, workload, bench::workload##_source())
+
+        LOX_BENCHMARK_WORKLOAD(numeric_loop);
+        LOX_BENCHMARK_WORKLOAD(string_concat);
+        LOX_BENCHMARK_WORKLOAD(global_heavy);
+        LOX_BENCHMARK_WORKLOAD(deep_scopes);
+        LOX_BENCHMARK_WORKLOAD(large_generated);
+
+#undef LOX_BENCHMARK_WORKLOAD
+    } // namespace
+} // namespace lox
@@ -0,0 +1,61 @@
+#include "trace.h"
+#include "vm.h"
+#include "workloads.h"
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <string>
+
+namespace lox
+{
+    namespace
+    {
+        // Two branches per iteration, the if alternates
+        constexpr auto script = R"(
+            var odd = false;
+            var count = 0;
+            for (var i = 0; i < 20000; i = i + 1) {
+                odd = !odd;
+                if (odd) count = count + 1;
+            }
+        )";
+
+        void BM_Untraced(benchmark::State& state)
+        {
+            const auto program = bench::compile(script);
+            auto vm = VM{};
+            for (auto _ : state) {
+                vm.execute(program);
+                state.PauseTiming();
+                vm.reset();
+                state.ResumeTiming();
+            }
+        }
+        BENCHMARK(BM_Untraced);
+
+        // Tracing is meant to stay within 10% of BM_Untraced
+        void BM_Traced(benchmark::State& state)
+        {
+            const auto path = (std::filesystem::temp_directory_path() / "lox-bench.trace").string();
+            auto recorder = TraceRecorder::create(path.c_str());
+            if (!recorder) {
+                state.SkipWithError(recorder.error().c_str());
+                return;
+            }
+            const auto program = bench::compile(script);
+            auto vm = VM{};
+            vm.set_branch_observer(recorder->get());
+            for (auto _ : state) {
+                vm.execute(program);
+                state.PauseTiming();
+                vm.reset();
+                state.ResumeTiming();
+            }
+            (*recorder)->finish();
+            state.counters["records"] = static_cast<double>((*recorder)->recorded());
+            std::filesystem::remove(path);
+        }
+        BENCHMARK(BM_Traced);
+    } // namespace
+} // namespace lox
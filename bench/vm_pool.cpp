@@ -0,0 +1,54 @@
+#include "vm.h"
+#include "vm_pool.h"
+#include "workloads.h"
+
+#include <benchmark/benchmark.h>
+
+namespace lox
+{
+    namespace
+    {
+        constexpr auto script = R"(
+            var total = 0;
+            for (var i = 0; i < 16; i = i + 1) {
+                total = total + i;
+            }
+            var greeting = "hello";
+        )";
+
+        void BM_FreshVM(benchmark::State& state)
+        {
+            const auto program = bench::compile(script);
+            for (auto _ : state) {
+                auto vm = VM{};
+                vm.execute(program);
+                benchmark::DoNotOptimize(vm);
+            }
+        }
+        BENCHMARK(BM_FreshVM);
+
+        void BM_PooledVM(benchmark::State& state)
+        {
+            const auto program = bench::compile(script);
+            auto pool = VMPool{1};
+            for (auto _ : state) {
+                auto vm = pool.acquire();
+                vm->execute(program);
+                benchmark::DoNotOptimize(vm.get());
+            }
+        }
+        BENCHMARK(BM_PooledVM);
+
+        void BM_PooledVMContended(benchmark::State& state)
+        {
+            static auto pool = VMPool{4};
+            const auto program = bench::compile(script);
+            for (auto _ : state) {
+                auto vm = pool.acquire();
+                vm->execute(program);
+                benchmark::DoNotOptimize(vm.get());
+            }
+        }
+        BENCHMARK(BM_PooledVMContended)->Threads(1)->Threads(4);
+    } // namespace
+} // namespace lox
@@ -0,0 +1,95 @@
+#include "workloads.h"
+
+#include "lexer.h"
+#include "parser.h"
+
+#include <fmt/format.h>
+
+#include <stdexcept>
+
+namespace lox::bench
+{
+    std::string numeric_loop_source()
+    {
+        return R"(
+            var sum = 0;
+            for (var i = 0; i < 20000; i = i + 1) {
+                sum = sum + i * 2 - i / 3;
+            }
+        )";
+    }
+
+    std::string string_concat_source()
+    {
+        return R"(
+            var text = "";
+            for (var i = 0; i < 2000; i = i + 1) {
+                text = text + "abc";
+            }
+        )";
+    }
+
+    std::string global_heavy_source()
+    {
+        constexpr int globals_count = 64;
+        std::string source;
+        for (int i = 0; i < globals_count; ++i) {
+            source += fmt::format("var global_{} = {};\n", i, i);
+        }
+        source += "var round = 0;\nwhile (round < 200) {\n";
+        for (int i = 0; i < globals_count; ++i) {
+            source += fmt::format("    global_{} = global_{} + 1;\n", i, (i + 1) % globals_count);
+        }
+        source += "    round = round + 1;\n}\n";
+        return source;
+    }
+
+    std::string deep_scopes_source()
+    {
+        constexpr int depth = 48;
+        std::string source = "for (var i = 0; i < 200; i = i + 1) {\n";
+        for (int i = 0; i < depth; ++i) {
+            source += fmt::format("{{ var local_{} = i + {};\n", i, i % 8);
+        }
+        source += "var innermost = local_0 + local_47;\n";
+        for (int i = 0; i < depth; ++i) {
+            source += "}\n";
+        }
+        source += "}\n";
+        return source;
+    }
+
+    std::string large_generated_source()
+    {
+        std::string source = "var total = 0;\n";
+        for (int i = 0; i < 5000; ++i) {
+            source += fmt::format(R"(// Declaration {}
+{{
+    var a = 7;
+    var b = a * 2 + 1;
+    if (b > 10 and a != 3) {{ b = b - 1; }} else {{ b = b + 1; }}
+    while (a > 0) {{ a = a - 1; }}
+    total = total + b;
+}}
+)",
+                                  i);
+        }
+        return source;
+    }
+
+    CompileOutput compile(std::string_view source)
+    {
+        auto lexer = Lexer{source};
+        auto parser = Parser{lexer};
+        const auto statements = parser.parse();
+        if (!statements) {
+            throw std::runtime_error(statements.error().front().what());
+        }
+        auto compiler = BytecodeCompiler{};
+        auto output = compiler.compile(*statements);
+        if (!output) {
+            throw std::runtime_error(output.error().message);
+        }
+        return std::move(*output);
+    }
+} // namespace lox::bench
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "bytecode_compiler.h"
+
+#include <string>
+#include <string_view>
+
+namespace lox::bench
+{
+    // Scripts shared by the per-phase & end-to-end benchmarks. None of them print so the VM benchmarks measure
+    // execution rather than stdout
+    std::string numeric_loop_source();
+    std::string string_concat_source();
+    std::string global_heavy_source();
+    std::string deep_scopes_source();
+    // Many small declarations & blocks, sized for the front-end rather than for execution
+    std::string large_generated_source();
+
+    // Lexes, parses & compiles, throwing std::runtime_error on any error
+    CompileOutput compile(std::string_view source);
+} // namespace lox::bench
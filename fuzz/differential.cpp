@@ -0,0 +1,147 @@
+#include "differential.h"
+
+#include "bytecode_compiler.h"
+#include "error.h"
+#include "execution_task.h"
+#include "incremental_compiler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "vm.h"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace lox::fuzz
+{
+    namespace
+    {
+        constexpr std::uint64_t async_slice = 4;
+        static_assert(default_budget % async_slice == 0);
+
+        using Program = tl::expected<CompileOutput, std::vector<std::string>>;
+
+        Program compile(std::string_view source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto ast = parser.parse();
+            if (!ast) {
+                std::vector<std::string> errors;
+                for (const auto& error : ast.error()) {
+                    errors.emplace_back(error.what());
+                }
+                return tl::unexpected(std::move(errors));
+            }
+            auto compiler = BytecodeCompiler{};
+            auto output = compiler.compile(*ast);
+            if (!output) {
+                return tl::unexpected(std::vector{std::move(output.error().message)});
+            }
+            return std::move(*output);
+        }
+
+        // True if the program completed within the budget
+        bool execute(VM& vm, const CompileOutput& program, ExecutionMode mode, std::uint64_t budget)
+        {
+            switch (mode) {
+                case ExecutionMode::Sliced: {
+                    auto status = vm.execute(program, 1);
+                    for (std::uint64_t used = 1; status != ExecutionStatus::Completed && used < budget; ++used) {
+                        status = vm.resume(1);
+                    }
+                    return status == ExecutionStatus::Completed;
+                }
+                case ExecutionMode::Async: {
+                    assert(budget % async_slice == 0 && "budget has to be a multiple of the async slice");
+                    auto task = vm.execute_async(program, async_slice);
+                    for (std::uint64_t used = 0; used < budget; used += async_slice) {
+                        if (!task.resume()) {
+                            return true;
+                        }
+                    }
+                    return task.done();
+                }
+                case ExecutionMode::Direct:
+                case ExecutionMode::Instrumented:
+                case ExecutionMode::Incremental:
+                    break;
+            }
+            return vm.execute(program, budget) == ExecutionStatus::Completed;
+        }
+    } // namespace
+
+    const char* format_as(ExecutionMode mode)
+    {
+        switch (mode) {
+            case ExecutionMode::Direct:
+                return "direct";
+            case ExecutionMode::Sliced:
+                return "sliced";
+            case ExecutionMode::Async:
+                return "async";
+            case ExecutionMode::Instrumented:
+                return "instrumented";
+            case ExecutionMode::Incremental:
+                return "incremental";
+        }
+        return "unknown";
+    }
+
+    Outcome run(std::string_view source, ExecutionMode mode, std::uint64_t budget)
+    {
+        auto outcome = Outcome{};
+        auto incremental_compiler = IncrementalCompiler{};
+        const auto program = mode == ExecutionMode::Incremental ? incremental_compiler.compile(source) : compile(source);
+        if (!program) {
+            outcome.error = fmt::format("{}", fmt::join(program.error(), "\n"));
+            return outcome;
+        }
+
+        auto vm = VM{};
+        vm.set_output(&outcome.output);
+        if (mode == ExecutionMode::Instrumented) {
+            vm.enable_allocation_stats();
+        }
+        try {
+            if (!execute(vm, *program, mode, budget)) {
+                outcome.error = "budget exhausted";
+            }
+        } catch (const LoxError& error) {
+            outcome.error = error.what();
+        }
+        return outcome;
+    }
+
+    std::optional<Mismatch> run_all_modes(std::string_view source, std::uint64_t budget)
+    {
+        const auto expected = run(source, ExecutionMode::Direct, budget);
+        for (const auto mode : execution_modes) {
+            if (mode == ExecutionMode::Direct) {
+                continue;
+            }
+            auto actual = run(source, mode, budget);
+            if (actual != expected) {
+                return Mismatch{.mode = mode, .expected = expected, .actual = std::move(actual)};
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::string describe(const Mismatch& mismatch)
+    {
+        const auto describe_outcome = [](const Outcome& outcome) {
+            return fmt::format("output:\n{}error: {}\n", outcome.output, outcome.error.empty() ? "none" : outcome.error);
+        };
+        return fmt::format("{} differs from {}\n--- {}\n{}--- {}\n{}",
+                           mismatch.mode,
+                           ExecutionMode::Direct,
+                           ExecutionMode::Direct,
+                           describe_outcome(mismatch.expected),
+                           mismatch.mode,
+                           describe_outcome(mismatch.actual));
+    }
+} // namespace lox::fuzz
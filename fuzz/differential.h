@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace lox::fuzz
+{
+    // The ways the interpreter can run a program, all of them have to print the same & fail the same way
+    enum class ExecutionMode : std::uint8_t {
+        // Lexer, Parser & BytecodeCompiler, plain dispatch loop. The reference for the other modes
+        Direct,
+        // Suspended & resumed at every backward jump
+        Sliced,
+        // VM::execute_async() with a small slice budget
+        Async,
+        // Instrumented dispatch loop, selected by allocation accounting
+        Instrumented,
+        // IncrementalCompiler front end, one unit per top-level statement
+        Incremental,
+    };
+
+    inline constexpr std::array execution_modes = {
+        ExecutionMode::Direct,
+        ExecutionMode::Sliced,
+        ExecutionMode::Async,
+        ExecutionMode::Instrumented,
+        ExecutionMode::Incremental,
+    };
+
+    const char* format_as(ExecutionMode mode);
+
+    // Backward jumps a program may perform before it is stopped, keeps generated infinite loops finite.
+    // A multiple of the Async slice budget so every mode stops at the same jump
+    inline constexpr std::uint64_t default_budget = 4096;
+
+    struct Outcome {
+        std::string output;
+        // Compile or runtime error, "budget exhausted" if the program was stopped, empty on success
+        std::string error;
+
+        bool operator==(const Outcome&) const = default;
+    };
+
+    Outcome run(std::string_view source, ExecutionMode mode, std::uint64_t budget = default_budget);
+
+    struct Mismatch {
+        ExecutionMode mode;
+        Outcome expected;
+        Outcome actual;
+    };
+
+    // Runs the source in every mode & compares each outcome with the Direct one
+    std::optional<Mismatch> run_all_modes(std::string_view source, std::uint64_t budget = default_budget);
+
+    // Human readable report of both outcomes
+    std::string describe(const Mismatch& mismatch);
+} // namespace lox::fuzz
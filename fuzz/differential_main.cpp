@@ -0,0 +1,29 @@
+#include "differential.h"
+#include "source_file.h"
+
+#include <fmt/core.h>
+
+// Runs each script in every execution mode & reports those that print or fail differently, e.g. to check a crash
+// reproducer or a corpus without building with clang
+int main(int argc, const char* argv[])
+{
+    if (argc < 2) {
+        fmt::println(stderr, "usage: {} <script>...", argv[0]);
+        return 1;
+    }
+
+    int mismatches = 0;
+    for (int i = 1; i < argc; ++i) {
+        const auto source = lox::SourceFile::open(argv[i]);
+        if (!source) {
+            fmt::println(stderr, "{}", source.error());
+            return 1;
+        }
+        if (const auto mismatch = lox::fuzz::run_all_modes(source->text())) {
+            fmt::print("{}: {}", argv[i], lox::fuzz::describe(*mismatch));
+            ++mismatches;
+        }
+    }
+    fmt::println("{} of {} scripts differ between execution modes", mismatches, argc - 1);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+#include "differential.h"
+
+#include <fmt/core.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+
+// Runs the input in every execution mode & aborts on the first one that prints or fails differently
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+    const auto source = std::string_view{reinterpret_cast<const char*>(data), size};
+    if (const auto mismatch = lox::fuzz::run_all_modes(source)) {
+        fmt::print(stderr, "{}", lox::fuzz::describe(*mismatch));
+        std::abort();
+    }
+    return 0;
+}
@@ -0,0 +1,21 @@
+#include "bytecode_compiler.h"
+#include "lexer.h"
+#include "parser.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Lexes, parses & compiles arbitrary input. Errors are expected, crashes & failed assertions are what it looks for
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+    const auto source = std::string_view{reinterpret_cast<const char*>(data), size};
+    auto lexer = lox::Lexer{source};
+    auto parser = lox::Parser{lexer};
+    const auto ast = parser.parse();
+    if (ast) {
+        auto compiler = lox::BytecodeCompiler{};
+        [[maybe_unused]] const auto output = compiler.compile(*ast);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+    thread_local std::uint64_t allocated_bytes_ = 0;
+} // namespace
+
+// Replacements counting the requested bytes. The other forms of new & delete forward to these, except the aligned
+// ones which aren't counted
+void* operator new(std::size_t size)
+{
+    allocated_bytes_ += size;
+    if (auto* memory = std::malloc(size != 0 ? size : 1)) [[likely]] {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace lox
+{
+    std::uint64_t thread_allocated_bytes()
+    {
+        return allocated_bytes_;
+    }
+} // namespace lox
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lox
+{
+    // Bytes requested through operator new on this thread since it started, e.g. as the allocation counter of
+    // PhaseTimings. allocation_counter.cpp defines it along with a global operator new & delete counting them, it
+    // isn't part of the lox library so only the targets linking lox-allocation-counter pay for the counting
+    [[nodiscard]] std::uint64_t thread_allocated_bytes();
+} // namespace lox
@@ -0,0 +1,84 @@
+#include "allocation_stats.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace lox
+{
+    namespace
+    {
+        void add(AllocationCount& counter, std::size_t bytes)
+        {
+            counter.count += 1;
+            counter.bytes += bytes;
+        }
+    } // namespace
+
+    void AllocationStats::record_allocation(std::size_t bytes)
+    {
+        add(total_, bytes);
+        if (instruction_) {
+            add(by_instruction_[static_cast<std::size_t>(*instruction_)], bytes);
+        }
+        live_bytes_ += bytes;
+        peak_live_bytes_ = std::max(peak_live_bytes_, live_bytes_);
+    }
+
+    void AllocationStats::record_free(std::size_t bytes)
+    {
+        // Objects allocated before the stats were active aren't part of the live bytes
+        live_bytes_ -= std::min<std::uint64_t>(bytes, live_bytes_);
+    }
+
+    void AllocationStats::record_type(const char* type, std::size_t bytes)
+    {
+        add(by_type_[type], bytes);
+    }
+
+    void AllocationStats::record_string_copy(std::size_t bytes)
+    {
+        add(string_copies_, bytes);
+    }
+
+    void AllocationStats::clear()
+    {
+        *this = AllocationStats{};
+    }
+
+    AllocationCount AllocationStats::by_type(std::string_view type) const
+    {
+        const auto iter = by_type_.find(type);
+        return iter != by_type_.end() ? iter->second : AllocationCount{};
+    }
+
+    std::string AllocationStats::report() const
+    {
+        auto report = fmt::format("{:<16}{:>14}{:>16}\n", "objects", "count", "bytes");
+        report += fmt::format("{:<16}{:>14}{:>16}\n", "total", total_.count, total_.bytes);
+        report += fmt::format("{:<16}{:>14}{:>16}\n", "peak live", "", peak_live_bytes_);
+        report += fmt::format("{:<16}{:>14}{:>16}\n", "string copies", string_copies_.count, string_copies_.bytes);
+
+        std::vector<std::pair<std::string_view, AllocationCount>> types{by_type_.begin(), by_type_.end()};
+        std::ranges::sort(types, std::greater{}, [](const auto& type) { return type.second.bytes; });
+        report += fmt::format("\n{:<16}{:>14}{:>16}\n", "type", "count", "bytes");
+        for (const auto& [type, counter] : types) {
+            report += fmt::format("{:<16}{:>14}{:>16}\n", type, counter.count, counter.bytes);
+        }
+
+        std::vector<Instruction> instructions;
+        for (std::size_t i = 0; i < by_instruction_.size(); ++i) {
+            if (by_instruction_[i].count != 0) {
+                instructions.push_back(static_cast<Instruction>(i));
+            }
+        }
+        std::ranges::sort(instructions, std::greater{}, [this](Instruction op) { return by_instruction(op).bytes; });
+        report += fmt::format("\n{:<16}{:>14}{:>16}\n", "instruction", "count", "bytes");
+        for (const auto op : instructions) {
+            report += fmt::format("{:<16}{:>14}{:>16}\n", op, by_instruction(op).count, by_instruction(op).bytes);
+        }
+        return report;
+    }
+} // namespace lox
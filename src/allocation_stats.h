@@ -0,0 +1,80 @@
+#pragma once
+
+#include "vm_instruction.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace lox
+{
+    struct AllocationCount {
+        std::uint64_t count = 0;
+        std::uint64_t bytes = 0;
+    };
+
+    // Accounts LoxObject allocations made on this thread while a Scope is active, see VM::enable_allocation_stats().
+    // Objects are counted by type & by the instruction that allocated them. Live bytes only include frees that
+    // happen while a Scope is active, objects still held by a VM stay live. Objects are only recorded in builds
+    // configured with -DLOX_ALLOCATION_STATS=ON, allocating one costs nothing extra otherwise
+    class AllocationStats
+    {
+    public:
+        // Makes the stats the thread's active stats while in scope, a null pointer keeps the current ones
+        class Scope
+        {
+        public:
+            explicit Scope(AllocationStats* stats)
+                : previous_(stats != nullptr ? std::exchange(active_, stats) : active_)
+            {
+            }
+            ~Scope() { active_ = previous_; }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            AllocationStats* previous_;
+        };
+
+        [[nodiscard]] static AllocationStats* active() { return active_; }
+
+        // Attributes the following allocations to `op`, std::nullopt for allocations made outside of instructions
+        void set_instruction(std::optional<Instruction> op) { instruction_ = op; }
+
+        // Called by LoxObject's operator new & delete
+        void record_allocation(std::size_t bytes);
+        void record_free(std::size_t bytes);
+        // Called by make_object() once the type is known
+        void record_type(const char* type, std::size_t bytes);
+        // Heap allocated std::string copies made by the VM, e.g. global names looked up by value
+        void record_string_copy(std::size_t bytes);
+        void clear();
+
+        [[nodiscard]] AllocationCount total() const { return total_; }
+        [[nodiscard]] AllocationCount by_type(std::string_view type) const;
+        [[nodiscard]] AllocationCount by_instruction(Instruction op) const { return by_instruction_[static_cast<std::size_t>(op)]; }
+        [[nodiscard]] AllocationCount string_copies() const { return string_copies_; }
+        [[nodiscard]] std::uint64_t live_bytes() const { return live_bytes_; }
+        [[nodiscard]] std::uint64_t peak_live_bytes() const { return peak_live_bytes_; }
+
+        // Totals followed by the types & instructions that allocated, sorted by bytes
+        [[nodiscard]] std::string report() const;
+
+    private:
+        static inline thread_local AllocationStats* active_ = nullptr;
+
+        std::optional<Instruction> instruction_;
+        AllocationCount total_;
+        AllocationCount string_copies_;
+        std::array<AllocationCount, 256> by_instruction_ = {};
+        std::map<std::string_view, AllocationCount> by_type_;
+        std::uint64_t live_bytes_ = 0;
+        std::uint64_t peak_live_bytes_ = 0;
+    };
+} // namespace lox
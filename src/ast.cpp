@@ -15,8 +15,9 @@ namespace lox
     {
     }
 
-    ParenExpr::ParenExpr(ExprPtr expr)
-        : expr_(std::move(expr))
+    ParenExpr::ParenExpr(Token paren, ExprPtr expr)
+        : paren_(paren)
+        , expr_(std::move(expr))
     {
     }
 
@@ -56,8 +57,9 @@ namespace lox
     {
     }
 
-    PrintStmt::PrintStmt(ExprPtr expr)
-        : expr_(std::move(expr))
+    PrintStmt::PrintStmt(Token keyword, ExprPtr expr)
+        : keyword_(keyword)
+        , expr_(std::move(expr))
     {
     }
 
@@ -74,20 +76,23 @@ namespace lox
     {
     }
 
-    BlockStmt::BlockStmt(std::vector<StmtPtr> statements)
-        : statements_(std::move(statements))
+    BlockStmt::BlockStmt(Token brace, std::vector<StmtPtr> statements)
+        : brace_(brace)
+        , statements_(std::move(statements))
     {
     }
 
-    IfStmt::IfStmt(ExprPtr condition, StmtPtr then_stmt, StmtPtr else_stmt)
-        : condition_(std::move(condition))
+    IfStmt::IfStmt(Token keyword, ExprPtr condition, StmtPtr then_stmt, StmtPtr else_stmt)
+        : keyword_(keyword)
+        , condition_(std::move(condition))
         , then_stmt_(std::move(then_stmt))
         , else_stmt_(std::move(else_stmt))
     {
     }
 
-    WhileStmt::WhileStmt(ExprPtr condition, StmtPtr body)
-        : condition_(std::move(condition))
+    WhileStmt::WhileStmt(Token keyword, ExprPtr condition, StmtPtr body)
+        : keyword_(keyword)
+        , condition_(std::move(condition))
         , body_(std::move(body))
     {
     }
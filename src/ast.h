@@ -92,13 +92,15 @@ namespace lox
     class ParenExpr : public Expr
     {
     public:
-        ParenExpr(ExprPtr expr);
+        ParenExpr(Token paren, ExprPtr expr);
 
         void accept(ExprVisitor& visitor) const override { return visitor.visit(*this); }
 
+        [[nodiscard]] auto& paren() const { return paren_; }
         [[nodiscard]] auto& expr() const { return *expr_; }
 
     private:
+        Token paren_;
         ExprPtr expr_;
     };
 
@@ -249,13 +251,15 @@ namespace lox
     class PrintStmt : public Stmt
     {
     public:
-        explicit PrintStmt(ExprPtr expr);
+        PrintStmt(Token keyword, ExprPtr expr);
 
         void accept(StmtVisitor& visitor) const override { visitor.visit(*this); }
 
+        [[nodiscard]] auto& keyword() const { return keyword_; }
         [[nodiscard]] auto& expr() const { return *expr_; }
 
     private:
+        Token keyword_;
         ExprPtr expr_;
     };
 
@@ -294,28 +298,32 @@ namespace lox
     class BlockStmt : public Stmt
     {
     public:
-        explicit BlockStmt(std::vector<StmtPtr> statements);
+        BlockStmt(Token brace, std::vector<StmtPtr> statements);
 
         void accept(StmtVisitor& visitor) const override { visitor.visit(*this); }
 
+        [[nodiscard]] auto& brace() const { return brace_; }
         [[nodiscard]] auto& statements() const { return statements_; }
 
     private:
+        Token brace_;
         std::vector<StmtPtr> statements_;
     };
 
     class IfStmt : public Stmt
     {
     public:
-        IfStmt(ExprPtr condition, StmtPtr then_stmt, StmtPtr else_stmt);
+        IfStmt(Token keyword, ExprPtr condition, StmtPtr then_stmt, StmtPtr else_stmt);
 
         void accept(StmtVisitor& visitor) const override { visitor.visit(*this); }
 
+        [[nodiscard]] auto& keyword() const { return keyword_; }
         [[nodiscard]] auto& condition() const { return *condition_; }
         [[nodiscard]] auto& then_branch() const { return *then_stmt_; }
         [[nodiscard]] auto* else_branch() const { return else_stmt_.get(); }
 
     private:
+        Token keyword_;
         ExprPtr condition_;
         StmtPtr then_stmt_;
         StmtPtr else_stmt_;
@@ -324,14 +332,16 @@ namespace lox
     class WhileStmt : public Stmt
     {
     public:
-        WhileStmt(ExprPtr condition, StmtPtr body);
+        WhileStmt(Token keyword, ExprPtr condition, StmtPtr body);
 
         void accept(StmtVisitor& visitor) const override { visitor.visit(*this); }
 
+        [[nodiscard]] auto& keyword() const { return keyword_; }
         [[nodiscard]] auto& condition() const { return *condition_; }
         [[nodiscard]] auto& body() const { return *body_; }
 
     private:
+        Token keyword_;
         ExprPtr condition_;
         StmtPtr body_;
     };
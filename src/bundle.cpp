@@ -0,0 +1,93 @@
+#include "bundle.h"
+
+#include "error.h"
+#include "lexer.h"
+#include "linker.h"
+#include "parser.h"
+#include "source_file.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+
+namespace lox
+{
+    namespace
+    {
+        BundleResult compile_file(const std::string& filename)
+        {
+            const auto file = SourceFile::open(filename.c_str());
+            if (!file) {
+                return tl::unexpected(std::vector{file.error()});
+            }
+            const auto source = file->text();
+
+            std::vector<std::string> errors;
+            try {
+                auto lexer = Lexer{source};
+                auto parser = Parser{lexer};
+                const auto parse_result = parser.parse();
+                if (!parse_result) {
+                    for (const auto& error : parse_result.error()) {
+                        errors.push_back(fmt::format("{}: {}", filename, error.what()));
+                    }
+                    return tl::unexpected(std::move(errors));
+                }
+
+                auto compiler = BytecodeCompiler{};
+                auto compile_result = compiler.compile(*parse_result);
+                if (!compile_result) {
+                    errors.push_back(fmt::format("{}: {}", filename, compile_result.error().message));
+                    return tl::unexpected(std::move(errors));
+                }
+                return std::move(*compile_result);
+            } catch (const LoxError& error) {
+                errors.push_back(fmt::format("{}: {}", filename, error.what()));
+                return tl::unexpected(std::move(errors));
+            }
+        }
+    } // namespace
+
+    BundleResult load_bundle(std::span<const std::string> filenames, unsigned thread_count)
+    {
+        std::vector<BundleResult> results(filenames.size());
+        {
+            std::atomic<std::size_t> next_file = 0;
+            const auto worker = [&]() {
+                for (auto index = next_file++; index < filenames.size(); index = next_file++) {
+                    results[index] = compile_file(filenames[index]);
+                }
+            };
+
+            const auto workers_count = std::clamp<std::size_t>(thread_count, 1, std::max<std::size_t>(filenames.size(), 1));
+            std::vector<std::jthread> workers;
+            workers.reserve(workers_count - 1);
+            for (std::size_t i = 1; i < workers_count; ++i) {
+                workers.emplace_back(worker);
+            }
+            worker();
+        }
+
+        std::vector<CompileOutput> units;
+        std::vector<std::string> errors;
+        units.reserve(results.size());
+        for (auto& result : results) {
+            if (result) {
+                units.push_back(std::move(*result));
+            } else {
+                std::ranges::move(result.error(), std::back_inserter(errors));
+            }
+        }
+        if (!errors.empty()) {
+            return tl::unexpected(std::move(errors));
+        }
+
+        auto program = link(units, filenames);
+        if (!program) {
+            return tl::unexpected(std::vector{fmt::format("failed to link bundle: {}", program.error().message)});
+        }
+        return std::move(*program);
+    }
+} // namespace lox
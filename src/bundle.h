@@ -0,0 +1,21 @@
+#pragma once
+
+#include "bytecode_compiler.h"
+
+#include <tl/expected.hpp>
+
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lox
+{
+    using BundleResult = tl::expected<CompileOutput, std::vector<std::string>>;
+
+    // Lexes, parses & compiles each file on a pool of up to `thread_count` threads, every file with its own
+    // Lexer, Parser & BytecodeCompiler. The units are then linked in the order the files were given, so the
+    // result doesn't depend on scheduling. Errors from all files are reported, prefixed with the file name, and
+    // so are runtime errors of the linked program
+    BundleResult load_bundle(std::span<const std::string> filenames, unsigned thread_count = std::thread::hardware_concurrency());
+} // namespace lox
@@ -25,6 +25,7 @@ namespace lox
         void jump_signed(std::int16_t offset);
 
         [[nodiscard]] bool is_eof() const { return isp_ >= bytecode_.size(); }
+        [[nodiscard]] std::size_t position() const { return isp_; }
 
     private:
         std::span<const std::uint8_t> bytecode_;
@@ -10,6 +10,7 @@
 #include <bit>
 #include <cassert>
 #include <ranges>
+#include <utility>
 
 namespace lox
 {
@@ -31,41 +32,157 @@ namespace lox
         };
     } // namespace
 
-    CompileResult BytecodeCompiler::compile(const std::vector<StmtPtr>& statements)
+    std::uint8_t ConstantPool::add_string(std::string_view string)
     {
+        if (auto iter = strings_.find(string); iter != strings_.end()) {
+            return iter->second;
+        }
+        auto bytes = std::vector<std::uint8_t>{string.begin(), string.end()};
+        bytes.push_back(0);
+        const auto index = add_constant('s', bytes);
+        strings_.emplace(string, index);
+        return index;
+    }
+
+    std::uint8_t ConstantPool::add_number(NumberLiteral number)
+    {
+        if (auto iter = numbers_.find(number); iter != numbers_.end()) {
+            return iter->second;
+        }
+        const auto bytes = std::bit_cast<std::array<std::uint8_t, sizeof(NumberLiteral)>>(number);
+        const auto index = add_constant('d', bytes);
+        numbers_.insert(std::make_pair(number, index));
+        return index;
+    }
+
+    void ConstantPool::rewind(const Mark& mark)
+    {
+        assert(mark.count <= count_ && "mark is newer than the pool");
+        std::erase_if(strings_, [&mark](const auto& entry) { return entry.second >= mark.count; });
+        std::erase_if(numbers_, [&mark](const auto& entry) { return entry.second >= mark.count; });
+        bytes_.resize(mark.size);
+        count_ = mark.count;
+    }
+
+    std::uint8_t ConstantPool::add_constant(std::uint8_t type, std::span<const std::uint8_t> bytes)
+    {
+        if (count_ > UINT8_MAX) {
+            throw CompileError{"can't have more than 256 constants"};
+        }
+        const auto constant_index = static_cast<std::uint8_t>(count_++);
+        bytes_.push_back('@');
+        bytes_.push_back(constant_index);
+        bytes_.push_back(type);
+        bytes_.insert(bytes_.end(), bytes.begin(), bytes.end());
+        return constant_index;
+    }
+
+    CompileResult BytecodeCompiler::compile(const FlatAst& ast)
+    {
+        ast_ = &ast;
+        source_ = ast.source();
+        cursor_offset_ = 0;
+        cursor_line_ = 1;
         try {
-            for (const auto& stmt : statements) {
-                compile(*stmt);
+            for (const auto stmt : ast.roots()) {
+                compile_stmt(stmt);
             }
+            const auto& constants = constants_.bytes();
             std::vector<std::uint8_t> bytecode;
-            bytecode.reserve(code_.size() + constants_.size());
-            bytecode.insert(bytecode.end(), constants_.begin(), constants_.end());
+            bytecode.reserve(code_.size() + constants.size());
+            bytecode.insert(bytecode.end(), constants.begin(), constants.end());
             bytecode.insert(bytecode.end(), code_.begin(), code_.end());
-            return CompileOutput{bytecode};
+            return CompileOutput{bytecode, max_stack_depth_, lines_};
         } catch (const CompileError& err) {
             return tl::unexpected(err);
         }
     }
 
-    void BytecodeCompiler::compile(const Stmt& stmt)
+    CompileResult BytecodeCompiler::compile(const std::vector<StmtPtr>& statements, std::string_view source)
     {
-        stmt.accept(*this);
+        const auto ast = flatten(statements, source);
+        return compile(ast);
     }
 
-    void BytecodeCompiler::compile(const Expr& expr)
+    void BytecodeCompiler::compile_stmt(NodeIndex index)
     {
-        expr.accept(*this);
+        const auto& stmt = ast_->stmt(index);
+        const auto enclosing_offset = std::exchange(current_offset_, stmt.offset);
+        switch (stmt.kind) {
+            case StmtKind::Expr:
+                compile_expr(stmt.first);
+                write_instruction(Instruction::Pop);
+                break;
+            case StmtKind::Print:
+                compile_expr(stmt.first);
+                write_instruction(Instruction::Print);
+                break;
+            case StmtKind::VarDecl:
+                var_decl_stmt(stmt);
+                break;
+            case StmtKind::FunDecl:
+            case StmtKind::Return:
+                write_instruction(Instruction::Trap);
+                break;
+            case StmtKind::Block:
+                block_stmt(stmt);
+                break;
+            case StmtKind::If:
+                if_stmt(stmt);
+                break;
+            case StmtKind::While:
+                while_stmt(stmt);
+                break;
+        }
+        current_offset_ = enclosing_offset;
+    }
+
+    void BytecodeCompiler::compile_expr(NodeIndex index)
+    {
+        const auto& expr = ast_->expr(index);
+        const auto enclosing_offset = std::exchange(current_offset_, expr.offset);
+        switch (expr.kind) {
+            case ExprKind::Binary:
+                binary_expr(expr);
+                break;
+            case ExprKind::Unary:
+                unary_expr(expr);
+                break;
+            case ExprKind::Paren:
+                compile_expr(expr.first);
+                break;
+            case ExprKind::Literal:
+                literal_expr(expr);
+                break;
+            case ExprKind::Var:
+                var_expr(expr);
+                break;
+            case ExprKind::Assignment:
+                assignment_expr(expr);
+                break;
+            case ExprKind::Logic:
+                logic_expr(expr);
+                break;
+            case ExprKind::Call:
+                call_expr(expr);
+                break;
+        }
+        current_offset_ = enclosing_offset;
     }
 
     void BytecodeCompiler::write_instruction(Instruction instruction)
     {
         code_.push_back(static_cast<std::uint8_t>(instruction));
+        mark_line(1);
+        adjust_stack_depth(stack_effect(instruction));
     }
 
     void BytecodeCompiler::write_instruction(Instruction instruction, std::uint8_t operand)
     {
         code_.push_back(static_cast<std::uint8_t>(instruction));
         code_.push_back(operand);
+        mark_line(2);
+        adjust_stack_depth(stack_effect(instruction));
     }
 
     void BytecodeCompiler::write_instruction(Instruction instruction, std::uint8_t operand1, std::uint8_t operand2)
@@ -73,6 +190,28 @@ namespace lox
         code_.push_back(static_cast<std::uint8_t>(instruction));
         code_.push_back(operand1);
         code_.push_back(operand2);
+        mark_line(3);
+        adjust_stack_depth(stack_effect(instruction));
+    }
+
+    void BytecodeCompiler::adjust_stack_depth(int delta)
+    {
+        assert(delta >= 0 || stack_depth_ >= static_cast<std::size_t>(-delta));
+        stack_depth_ += delta;
+        max_stack_depth_ = std::max(max_stack_depth_, stack_depth_);
+    }
+
+    void BytecodeCompiler::mark_line(std::uint32_t length)
+    {
+        assert(current_offset_ <= source_.size());
+        const auto* source = source_.data();
+        if (current_offset_ >= cursor_offset_) {
+            cursor_line_ += static_cast<std::uint32_t>(std::count(source + cursor_offset_, source + current_offset_, '\n'));
+        } else {
+            cursor_line_ -= static_cast<std::uint32_t>(std::count(source + current_offset_, source + cursor_offset_, '\n'));
+        }
+        cursor_offset_ = current_offset_;
+        lines_.add(cursor_line_, length);
     }
 
     std::size_t BytecodeCompiler::start_jump(Instruction jmp_instruction)
@@ -95,46 +234,11 @@ namespace lox
         const auto offset = static_cast<std::int64_t>(code_.size()) - loop_start + 2;
         assert(std::cmp_less(offset, INT16_MAX));
         code_.resize(code_.size() + 2);
+        mark_line(2);
         const auto jump_i16 = -static_cast<std::int16_t>(offset);
         std::memcpy(&code_[code_.size() - 2], &jump_i16, sizeof(jump_i16));
     }
 
-    std::uint8_t BytecodeCompiler::add_constant(std::uint8_t type, std::span<const std::uint8_t> bytes)
-    {
-        if (constants_.size() >= UINT8_MAX) {
-            throw CompileError{"can't have more than 256 constants"};
-        }
-        constants_.push_back('@');
-        const auto constant_index = constant_index_++;
-        constants_.push_back(constant_index);
-        constants_.push_back(type);
-        constants_.insert(constants_.end(), bytes.begin(), bytes.end());
-        return constant_index;
-    }
-
-    std::uint8_t BytecodeCompiler::constant_string(const StringLiteral& string)
-    {
-        if (auto iter = strings_.find(string); iter != strings_.end()) {
-            return iter->second;
-        }
-        auto bytes = std::vector<std::uint8_t>{string.begin(), string.end()};
-        bytes.push_back(0);
-        const auto index = add_constant('s', bytes);
-        strings_.insert(std::make_pair(string, index));
-        return index;
-    }
-
-    std::uint8_t BytecodeCompiler::constant_number(const NumberLiteral& number)
-    {
-        if (auto iter = numbers_.find(number); iter != numbers_.end()) {
-            return iter->second;
-        }
-        const auto bytes = std::bit_cast<std::array<std::uint8_t, sizeof(NumberLiteral)>>(number);
-        const auto index = add_constant('d', bytes);
-        numbers_.insert(std::make_pair(number, index));
-        return index;
-    }
-
     void BytecodeCompiler::begin_scope()
     {
         scope_depth_ += 1;
@@ -149,21 +253,24 @@ namespace lox
         }
     }
 
-    int BytecodeCompiler::resolve_local(const Token& identifier)
+    int BytecodeCompiler::resolve_local(std::string_view identifier)
     {
-        auto iter = std::ranges::find(std::views::reverse(locals_), identifier.lexeme, &LocalVar::identifier);
+        auto iter = std::ranges::find(std::views::reverse(locals_), identifier, &LocalVar::identifier);
         if (iter == locals_.rend()) {
             return -1;
         }
+        if (iter->depth == -1) {
+            throw CompileError{fmt::format("can't read local variable '{}' in its own initializer", iter->identifier)};
+        }
 
         return static_cast<int>(std::distance(locals_.begin(), iter.base()) - 1);
     }
 
-    void BytecodeCompiler::visit(const BinaryExpr& expr)
+    void BytecodeCompiler::binary_expr(const ExprNode& expr)
     {
-        compile(expr.lhs());
-        compile(expr.rhs());
-        switch (expr.op().type) {
+        compile_expr(expr.first);
+        compile_expr(expr.second);
+        switch (expr.op) {
             case TokenType::Plus:
                 write_instruction(Instruction::Add);
                 break;
@@ -200,10 +307,10 @@ namespace lox
         }
     }
 
-    void BytecodeCompiler::visit(const UnaryExpr& expr)
+    void BytecodeCompiler::unary_expr(const ExprNode& expr)
     {
-        compile(expr.expr());
-        switch (expr.op().type) {
+        compile_expr(expr.first);
+        switch (expr.op) {
             case TokenType::Minus:
                 write_instruction(Instruction::Neg);
                 break;
@@ -213,51 +320,57 @@ namespace lox
         }
     }
 
-    void BytecodeCompiler::visit(const ParenExpr& expr)
+    void BytecodeCompiler::literal_expr(const ExprNode& expr)
     {
-        compile(expr.expr());
-    }
-
-    void BytecodeCompiler::visit(const LiteralExpr& expr)
-    {
-        if (std::get_if<NilLiteral>(&expr.literal())) {
-            write_instruction(Instruction::PushNil);
-        } else if (const auto* boolean = std::get_if<BooleanLiteral>(&expr.literal())) {
-            write_instruction(*boolean ? Instruction::PushTrue : Instruction::PushFalse);
-        } else if (const auto* string = std::get_if<StringLiteral>(&expr.literal())) {
-            const auto index = constant_string(*string);
-            write_instruction(Instruction::PushConstant, index);
-        } else if (const auto* number = std::get_if<NumberLiteral>(&expr.literal())) {
-            const auto index = constant_number(*number);
-            write_instruction(Instruction::PushConstant, index);
+        switch (expr.op) {
+            case TokenType::Nil:
+                write_instruction(Instruction::PushNil);
+                break;
+            case TokenType::True:
+                write_instruction(Instruction::PushTrue);
+                break;
+            case TokenType::False:
+                write_instruction(Instruction::PushFalse);
+                break;
+            case TokenType::String:
+                // Strip the quotes
+                write_instruction(Instruction::PushConstant, constants_.add_string(ast_->text(expr.offset + 1, expr.first - 2)));
+                break;
+            case TokenType::Number:
+                write_instruction(Instruction::PushConstant, constants_.add_number(ast_->number(expr.first)));
+                break;
+            default:
+                assert(false && "invalid literal token type");
         }
     }
 
-    void BytecodeCompiler::visit(const VarExpr& expr)
+    void BytecodeCompiler::var_expr(const ExprNode& expr)
     {
-        if (auto local = resolve_local(expr.identifier()); local != -1) {
+        const auto identifier = ast_->text(expr.offset, expr.first);
+        if (auto local = resolve_local(identifier); local != -1) {
             write_instruction(Instruction::GetLocal, local);
         } else {
-            const auto global = constant_string(StringLiteral{expr.identifier().lexeme});
+            const auto global = constants_.add_string(identifier);
             write_instruction(Instruction::GetGlobal, global);
         }
     }
 
-    void BytecodeCompiler::visit(const AssignmentExpr& expr)
+    void BytecodeCompiler::assignment_expr(const ExprNode& expr)
     {
-        compile(expr.value());
+        compile_expr(expr.first);
 
-        if (auto local = resolve_local(expr.identifier()); local != -1) {
+        const auto identifier = ast_->text(expr.offset, expr.second);
+        if (auto local = resolve_local(identifier); local != -1) {
             write_instruction(Instruction::SetLocal, local);
         } else {
-            const auto global = constant_string(StringLiteral{expr.identifier().lexeme});
+            const auto global = constants_.add_string(identifier);
             write_instruction(Instruction::SetGlobal, global);
         }
     }
 
-    void BytecodeCompiler::visit(const LogicExpr& expr)
+    void BytecodeCompiler::logic_expr(const ExprNode& expr)
     {
-        const auto jmp_type = [op = expr.op().type]() {
+        const auto jmp_type = [op = expr.op]() {
             if (op == TokenType::And) {
                 return Instruction::JmpFalse;
             }
@@ -266,46 +379,35 @@ namespace lox
             }
             assert(false && "invalid/unhandled logical operator");
         }();
-        compile(expr.lhs());
+        compile_expr(expr.first);
         const auto skip_rhs = start_jump(jmp_type);
         write_instruction(Instruction::Pop);
-        compile(expr.rhs());
+        compile_expr(expr.second);
         patch_jump(skip_rhs);
     }
 
-    void BytecodeCompiler::visit(const CallExpr& expr)
+    void BytecodeCompiler::call_expr(const ExprNode& expr)
     {
-        write_instruction(Instruction::Trap);
+        write_instruction(Instruction::Call);
     }
 
-    void BytecodeCompiler::visit(const ExprStmt& stmt)
-    {
-        compile(stmt.expr());
-        write_instruction(Instruction::Pop);
-    }
-
-    void BytecodeCompiler::visit(const PrintStmt& stmt)
-    {
-        compile(stmt.expr());
-        write_instruction(Instruction::Print);
-    }
-
-    void BytecodeCompiler::visit(const VarDeclStmt& stmt)
+    void BytecodeCompiler::var_decl_stmt(const StmtNode& stmt)
     {
+        const auto identifier = ast_->text(stmt.offset, stmt.length);
         if (scope_depth_ > 0) {
             for (auto iter = locals_.rbegin(); iter != locals_.rend(); ++iter) {
                 if (iter->depth != -1 && iter->depth < scope_depth_) {
                     break;
                 }
-                if (stmt.identifier().lexeme == iter->identifier && iter->depth == scope_depth_) {
+                if (identifier == iter->identifier && iter->depth == scope_depth_) {
                     throw CompileError{fmt::format("redefinition of local variable '{}' is not allowed", iter->identifier)};
                 }
             }
-            locals_.push_back({std::string{stmt.identifier().lexeme}, -1}); // Mark uninitialized
+            locals_.push_back({std::string{identifier}, -1}); // Mark uninitialized
         }
 
-        if (const auto* initializer = stmt.initializer()) {
-            compile(*initializer);
+        if (stmt.first != null_node) {
+            compile_expr(stmt.first);
         } else {
             write_instruction(Instruction::PushNil);
         }
@@ -313,54 +415,50 @@ namespace lox
         if (scope_depth_ > 0) {
             locals_.back().depth = scope_depth_; // Mark initialized
         } else {
-            const auto name = constant_string(StringLiteral{stmt.identifier().lexeme});
+            const auto name = constants_.add_string(identifier);
             write_instruction(Instruction::DefineGlobal, name);
         }
     }
 
-    void BytecodeCompiler::visit(const FunDeclStmt& stmt)
-    {
-        write_instruction(Instruction::Trap);
-    }
-
-    void BytecodeCompiler::visit(const BlockStmt& stmt)
+    void BytecodeCompiler::block_stmt(const StmtNode& stmt)
     {
         const auto scope = Scope{this};
-        for (const auto& statement : stmt.statements()) {
-            compile(*statement);
+        for (const auto statement : ast_->list(stmt.first)) {
+            compile_stmt(statement);
         }
     }
 
-    void BytecodeCompiler::visit(const IfStmt& stmt)
+    void BytecodeCompiler::if_stmt(const StmtNode& stmt)
     {
-        compile(stmt.condition());
+        compile_expr(stmt.first);
+        const auto condition_depth = stack_depth_;
 
         const auto skip_then = start_jump(Instruction::JmpFalse);
         write_instruction(Instruction::Pop);
-        compile(stmt.then_branch());
+        compile_stmt(stmt.second);
         const auto skip_else = start_jump(Instruction::Jmp);
-        write_instruction(Instruction::Pop);
+        // The else path is entered with the condition still on the stack
         patch_jump(skip_then);
-        if (const auto* else_branch = stmt.else_branch()) {
-            compile(*else_branch);
+        stack_depth_ = condition_depth;
+        write_instruction(Instruction::Pop);
+        if (stmt.third != null_node) {
+            compile_stmt(stmt.third);
         }
         patch_jump(skip_else);
     }
 
-    void BytecodeCompiler::visit(const WhileStmt& stmt)
+    void BytecodeCompiler::while_stmt(const StmtNode& stmt)
     {
         const auto loop_start = code_.size();
-        compile(stmt.condition());
+        compile_expr(stmt.first);
+        const auto condition_depth = stack_depth_;
         const auto loop_exit = start_jump(Instruction::JmpFalse);
         write_instruction(Instruction::Pop);
-        compile(stmt.body());
+        compile_stmt(stmt.second);
         do_loop(loop_start);
         patch_jump(loop_exit);
+        // The loop is exited with the condition still on the stack
+        stack_depth_ = condition_depth;
         write_instruction(Instruction::Pop);
     }
-
-    void BytecodeCompiler::visit(const ReturnStmt& stmt)
-    {
-        write_instruction(Instruction::Trap);
-    }
 } // namespace lox
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "ast.h"
+#include "flat_ast.h"
+#include "line_table.h"
 #include "vm_instruction.h"
 
 #include <tl/expected.hpp>
@@ -9,12 +11,19 @@
 #include <map>
 #include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace lox
 {
     struct CompileOutput {
         std::vector<std::uint8_t> bytecode;
+        // Highest number of stack slots the code can occupy, locals included
+        std::size_t max_stack_depth = 0;
+        // Source line of every code byte, for profiling & error locations
+        LineTable lines;
+        // Names of the files the code was linked from, indexed by LineRun::file. Empty for a single source
+        std::vector<std::string> files;
     };
 
     struct CompileError {
@@ -23,57 +32,89 @@ namespace lox
 
     using CompileResult = tl::expected<CompileOutput, CompileError>;
 
+    // Deduplicated constants serialized in the '@' prefixed format the VM loads
+    class ConstantPool
+    {
+    public:
+        // State of the pool at some point, see rewind()
+        struct Mark {
+            std::size_t count;
+            std::size_t size;
+        };
+
+        std::uint8_t add_string(std::string_view string);
+        std::uint8_t add_number(NumberLiteral number);
+
+        [[nodiscard]] auto& bytes() const { return bytes_; }
+
+        [[nodiscard]] Mark mark() const { return {.count = count_, .size = bytes_.size()}; }
+        // Drops the constants added since the mark
+        void rewind(const Mark& mark);
+
+    private:
+        std::uint8_t add_constant(std::uint8_t type, std::span<const std::uint8_t> bytes);
+
+        std::vector<std::uint8_t> bytes_;
+        std::size_t count_ = 0;
+        std::map<std::string, std::uint8_t, std::less<>> strings_;
+        std::map<double, std::uint8_t> numbers_;
+    };
+
     class BytecodeCompiler
-        : public ExprVisitor
-        , public StmtVisitor
     {
     public:
-        CompileResult compile(const std::vector<StmtPtr>& statements);
-        void compile(const Stmt& stmt);
-        void compile(const Expr& expr);
-
-        void visit(const BinaryExpr& expr) override;
-        void visit(const UnaryExpr& expr) override;
-        void visit(const ParenExpr& expr) override;
-        void visit(const LiteralExpr& expr) override;
-        void visit(const VarExpr& expr) override;
-        void visit(const AssignmentExpr& expr) override;
-        void visit(const LogicExpr& expr) override;
-        void visit(const CallExpr& expr) override;
-
-        void visit(const ExprStmt& stmt) override;
-        void visit(const PrintStmt& stmt) override;
-        void visit(const VarDeclStmt& stmt) override;
-        void visit(const FunDeclStmt& stmt) override;
-        void visit(const BlockStmt& stmt) override;
-        void visit(const IfStmt& stmt) override;
-        void visit(const WhileStmt& stmt) override;
-        void visit(const ReturnStmt& stmt) override;
+        CompileResult compile(const FlatAst& ast);
+        // Flattens the pointer tree first, see flatten()
+        CompileResult compile(const std::vector<StmtPtr>& statements, std::string_view source);
 
         void begin_scope();
         void end_scope();
 
     private:
+        void compile_stmt(NodeIndex index);
+        void compile_expr(NodeIndex index);
+
+        void binary_expr(const ExprNode& expr);
+        void unary_expr(const ExprNode& expr);
+        void literal_expr(const ExprNode& expr);
+        void var_expr(const ExprNode& expr);
+        void assignment_expr(const ExprNode& expr);
+        void logic_expr(const ExprNode& expr);
+        void call_expr(const ExprNode& expr);
+
+        void var_decl_stmt(const StmtNode& stmt);
+        void block_stmt(const StmtNode& stmt);
+        void if_stmt(const StmtNode& stmt);
+        void while_stmt(const StmtNode& stmt);
+
         void write_instruction(Instruction instruction);
         void write_instruction(Instruction instruction, std::uint8_t operand);
         void write_instruction(Instruction instruction, std::uint8_t operand1, std::uint8_t operand2);
+        void adjust_stack_depth(int delta);
+        // Attributes the last `length` code bytes to the line of the node being compiled
+        void mark_line(std::uint32_t length);
 
         std::size_t start_jump(Instruction jmp_instruction);
         void patch_jump(std::size_t offset);
 
         void do_loop(std::size_t loop_start);
 
-        std::uint8_t add_constant(std::uint8_t type, std::span<const std::uint8_t> bytes);
-        std::uint8_t constant_string(const StringLiteral& string);
-        std::uint8_t constant_number(const NumberLiteral& number);
-        int resolve_local(const Token& identifier);
+        int resolve_local(std::string_view identifier);
+
+        const FlatAst* ast_ = nullptr;
 
         std::vector<std::uint8_t> code_;
 
-        std::vector<std::uint8_t> constants_;
-        std::uint8_t constant_index_ = 0;
-        std::map<std::string, std::uint8_t> strings_;
-        std::map<double, std::uint8_t> numbers_;
+        std::string_view source_;
+        // Offset of the innermost node being compiled, the code it emits is attributed to its line
+        std::uint32_t current_offset_ = 0;
+        // Last offset resolved to a line. Nodes are compiled in roughly source order, so moving the cursor to the
+        // next node mostly walks forward over a few bytes instead of searching an index of every line
+        std::uint32_t cursor_offset_ = 0;
+        std::uint32_t cursor_line_ = 1;
+        LineTable lines_;
+
+        ConstantPool constants_;
 
         std::map<std::string, std::uint8_t, std::less<>> globals_;
 
@@ -84,5 +125,8 @@ namespace lox
 
         std::vector<LocalVar> locals_;
         int scope_depth_ = 0;
+
+        std::size_t stack_depth_ = 0;
+        std::size_t max_stack_depth_ = 0;
     };
 } // namespace lox
@@ -66,6 +66,7 @@ namespace lox
                 case Instruction::PushFalse:
                 case Instruction::Pop:
                 case Instruction::Print:
+                case Instruction::Call:
                 case Instruction::Trap:
                     result << format_default(op);
                     break;
@@ -74,4 +75,28 @@ namespace lox
 
         return result.str();
     }
+
+    std::size_t count_instructions(std::span<const std::uint8_t> code)
+    {
+        auto bytecode = Bytecode{code};
+        while (!bytecode.is_eof() && bytecode.peek() == '@') {
+            bytecode.read();
+            bytecode.read();
+            if (bytecode.read() == 'd') {
+                bytecode.read_number();
+            } else {
+                bytecode.read_string();
+            }
+        }
+
+        std::size_t count = 0;
+        while (!bytecode.is_eof()) {
+            const auto op = bytecode.fetch();
+            for (int i = 0; i < operand_size(op); ++i) {
+                bytecode.read();
+            }
+            ++count;
+        }
+        return count;
+    }
 } // namespace lox
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <span>
 #include <string>
@@ -7,4 +8,6 @@
 namespace lox
 {
     std::string disassemble(std::span<const std::uint8_t> code);
+    // Instructions in the code, the constants preceding them aren't counted
+    std::size_t count_instructions(std::span<const std::uint8_t> code);
 }
@@ -2,12 +2,38 @@
 
 #include <fmt/format.h>
 
+#include <utility>
+
 namespace lox
 {
     LoxError::LoxError(const std::string& message, SourceLocation location)
-        : message_(fmt::format("[{}:{}] Error: {}", location.line, location.column, message))
-        , location_(location)
+        : description_(message)
+    {
+        set_location(location);
+    }
+
+    void LoxError::set_location(SourceLocation location)
+    {
+        location_ = location;
+        format_message();
+    }
+
+    void LoxError::set_file(std::string file)
+    {
+        file_ = std::move(file);
+        format_message();
+    }
+
+    void LoxError::format_message()
     {
+        if (location_.column == 0 && location_.line != 0) {
+            message_ = fmt::format("[{}] Error: {}", location_.line, description_);
+        } else {
+            message_ = fmt::format("[{}:{}] Error: {}", location_.line, location_.column, description_);
+        }
+        if (!file_.empty()) {
+            message_ = fmt::format("{}: {}", file_, message_);
+        }
     }
 
     const char* LoxError::what() const noexcept
@@ -10,14 +10,24 @@ namespace lox
     class LoxError : public std::exception
     {
     public:
+        // A location with column 0 only names the line, e.g. errors raised by the VM
         LoxError(const std::string& message, SourceLocation location);
 
         [[nodiscard]] auto& msg() const { return message_; }
         [[nodiscard]] auto& location() const { return location_; }
+        [[nodiscard]] bool has_location() const { return location_.line != 0; }
+        // For errors raised without knowing where, e.g. by LoxObject operations called from the VM
+        void set_location(SourceLocation location);
+        // Prefixes the message with the file the error was raised in, for programs linked from several files
+        void set_file(std::string file);
 
         [[nodiscard]] const char* what() const noexcept override;
 
     private:
+        void format_message();
+
+        std::string file_;
+        std::string description_;
         std::string message_;
         SourceLocation location_;
     };
@@ -0,0 +1,61 @@
+#include "execution_task.h"
+
+#include <cassert>
+#include <utility>
+
+namespace lox
+{
+    ExecutionTask ExecutionTask::promise_type::get_return_object()
+    {
+        return ExecutionTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    std::suspend_always ExecutionTask::promise_type::yield_value(ExecutionStatus suspend_status) noexcept
+    {
+        status = suspend_status;
+        return {};
+    }
+
+    ExecutionTask::ExecutionTask(std::coroutine_handle<promise_type> handle)
+        : handle_(handle)
+    {
+    }
+
+    ExecutionTask::~ExecutionTask()
+    {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    ExecutionTask::ExecutionTask(ExecutionTask&& other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr))
+    {
+    }
+
+    ExecutionTask& ExecutionTask::operator=(ExecutionTask&& other) noexcept
+    {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    bool ExecutionTask::resume()
+    {
+        assert(!done() && "resuming a completed execution");
+        handle_.resume();
+        if (auto exception = std::exchange(handle_.promise().exception, nullptr)) {
+            std::rethrow_exception(exception);
+        }
+        return !handle_.done();
+    }
+
+    bool ExecutionTask::done() const
+    {
+        return handle_.done();
+    }
+} // namespace lox
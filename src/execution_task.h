@@ -0,0 +1,46 @@
+#pragma once
+
+#include "vm.h"
+
+#include <coroutine>
+#include <exception>
+
+namespace lox
+{
+    // Handle to a script running as a coroutine, see VM::execute_async().
+    // Nothing runs until the first call to resume()
+    class ExecutionTask
+    {
+    public:
+        struct promise_type {
+            ExecutionStatus status = ExecutionStatus::Completed;
+            std::exception_ptr exception;
+
+            ExecutionTask get_return_object();
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            std::suspend_always yield_value(ExecutionStatus suspend_status) noexcept;
+            void return_void() noexcept { status = ExecutionStatus::Completed; }
+            void unhandled_exception() noexcept { exception = std::current_exception(); }
+        };
+
+        explicit ExecutionTask(std::coroutine_handle<promise_type> handle);
+        ~ExecutionTask();
+
+        ExecutionTask(const ExecutionTask&) = delete;
+        ExecutionTask(ExecutionTask&& other) noexcept;
+        ExecutionTask& operator=(const ExecutionTask&) = delete;
+        ExecutionTask& operator=(ExecutionTask&& other) noexcept;
+
+        // Runs the script until its next suspension point, returns false once it has completed.
+        // Errors raised by the script are rethrown from here
+        bool resume();
+
+        [[nodiscard]] bool done() const;
+        // Why the script was last suspended, ExecutionStatus::Completed once done
+        [[nodiscard]] ExecutionStatus status() const { return handle_.promise().status; }
+
+    private:
+        std::coroutine_handle<promise_type> handle_;
+    };
+} // namespace lox
@@ -0,0 +1,273 @@
+#include "flat_ast.h"
+
+#include <cassert>
+#include <utility>
+#include <variant>
+
+namespace lox
+{
+    namespace
+    {
+        NodeIndex next_index(std::size_t size)
+        {
+            assert(size < null_node && "too many AST nodes");
+            return static_cast<NodeIndex>(size);
+        }
+
+        class Flattener
+            : public ExprVisitor
+            , public StmtVisitor
+        {
+        public:
+            explicit Flattener(FlatAst& ast)
+                : ast_(&ast)
+            {
+            }
+
+            NodeIndex flatten(const Stmt& stmt)
+            {
+                stmt.accept(*this);
+                return result_;
+            }
+
+            NodeIndex flatten(const Expr& expr)
+            {
+                expr.accept(*this);
+                return result_;
+            }
+
+            void visit(const BinaryExpr& expr) override
+            {
+                const auto lhs = flatten(expr.lhs());
+                const auto rhs = flatten(expr.rhs());
+                result_ = ast_->add_expr({.kind = ExprKind::Binary, .op = expr.op().type, .offset = expr.op().offset, .first = lhs, .second = rhs});
+            }
+
+            void visit(const UnaryExpr& expr) override
+            {
+                const auto operand = flatten(expr.expr());
+                result_ = ast_->add_expr({.kind = ExprKind::Unary, .op = expr.op().type, .offset = expr.op().offset, .first = operand});
+            }
+
+            void visit(const ParenExpr& expr) override
+            {
+                const auto inner = flatten(expr.expr());
+                result_ = ast_->add_expr({.kind = ExprKind::Paren, .offset = expr.paren().offset, .first = inner});
+            }
+
+            void visit(const LiteralExpr& expr) override
+            {
+                auto node = ExprNode{.kind = ExprKind::Literal, .offset = expr.token().offset};
+                if (std::holds_alternative<NilLiteral>(expr.literal())) {
+                    node.op = TokenType::Nil;
+                } else if (const auto* boolean = std::get_if<BooleanLiteral>(&expr.literal())) {
+                    node.op = *boolean ? TokenType::True : TokenType::False;
+                } else if (const auto* number = std::get_if<NumberLiteral>(&expr.literal())) {
+                    node.op = TokenType::Number;
+                    node.first = ast_->add_number(*number);
+                } else {
+                    node.op = TokenType::String;
+                    node.first = expr.token().length;
+                }
+                result_ = ast_->add_expr(node);
+            }
+
+            void visit(const VarExpr& expr) override
+            {
+                const auto& identifier = expr.identifier();
+                result_ = ast_->add_expr({.kind = ExprKind::Var, .offset = identifier.offset, .first = identifier.length});
+            }
+
+            void visit(const AssignmentExpr& expr) override
+            {
+                const auto value = flatten(expr.value());
+                const auto& identifier = expr.identifier();
+                result_ = ast_->add_expr({.kind = ExprKind::Assignment, .offset = identifier.offset, .first = value, .second = identifier.length});
+            }
+
+            void visit(const LogicExpr& expr) override
+            {
+                const auto lhs = flatten(expr.lhs());
+                const auto rhs = flatten(expr.rhs());
+                result_ = ast_->add_expr({.kind = ExprKind::Logic, .op = expr.op().type, .offset = expr.op().offset, .first = lhs, .second = rhs});
+            }
+
+            void visit(const CallExpr& expr) override
+            {
+                const auto callee = flatten(expr.calle());
+                std::vector<NodeIndex> arguments;
+                arguments.reserve(expr.args().size());
+                for (const auto& argument : expr.args()) {
+                    arguments.push_back(flatten(*argument));
+                }
+                const auto list = ast_->add_list(arguments);
+                result_ = ast_->add_expr({.kind = ExprKind::Call, .offset = expr.call_end().offset, .first = callee, .second = list});
+            }
+
+            void visit(const ExprStmt& stmt) override
+            {
+                const auto expr = flatten(stmt.expr());
+                result_ = ast_->add_stmt({.kind = StmtKind::Expr, .offset = start_of(expr), .first = expr});
+            }
+
+            void visit(const PrintStmt& stmt) override
+            {
+                const auto expr = flatten(stmt.expr());
+                result_ = ast_->add_stmt({.kind = StmtKind::Print, .offset = stmt.keyword().offset, .first = expr});
+            }
+
+            void visit(const VarDeclStmt& stmt) override
+            {
+                const auto* initializer = stmt.initializer();
+                const auto value = initializer != nullptr ? flatten(*initializer) : null_node;
+                const auto& identifier = stmt.identifier();
+                result_ = ast_->add_stmt({.kind = StmtKind::VarDecl, .offset = identifier.offset, .length = identifier.length, .first = value});
+            }
+
+            void visit(const FunDeclStmt& stmt) override
+            {
+                const auto params = ast_->add_params(stmt.params());
+                const auto body = flatten(stmt.body());
+                const auto count = static_cast<NodeIndex>(stmt.params().size());
+                const auto& identifier = stmt.identifier();
+                result_ = ast_->add_stmt({
+                    .kind = StmtKind::FunDecl,
+                    .offset = identifier.offset,
+                    .length = identifier.length,
+                    .first = params,
+                    .second = count,
+                    .third = body,
+                });
+            }
+
+            void visit(const BlockStmt& stmt) override
+            {
+                std::vector<NodeIndex> statements;
+                statements.reserve(stmt.statements().size());
+                for (const auto& statement : stmt.statements()) {
+                    statements.push_back(flatten(*statement));
+                }
+                result_ = ast_->add_stmt({.kind = StmtKind::Block, .offset = stmt.brace().offset, .first = ast_->add_list(statements)});
+            }
+
+            void visit(const IfStmt& stmt) override
+            {
+                const auto condition = flatten(stmt.condition());
+                const auto then_branch = flatten(stmt.then_branch());
+                const auto* else_stmt = stmt.else_branch();
+                const auto else_branch = else_stmt != nullptr ? flatten(*else_stmt) : null_node;
+                result_ = ast_->add_stmt({.kind = StmtKind::If, .offset = stmt.keyword().offset, .first = condition, .second = then_branch, .third = else_branch});
+            }
+
+            void visit(const WhileStmt& stmt) override
+            {
+                const auto condition = flatten(stmt.condition());
+                const auto body = flatten(stmt.body());
+                result_ = ast_->add_stmt({.kind = StmtKind::While, .offset = stmt.keyword().offset, .first = condition, .second = body});
+            }
+
+            void visit(const ReturnStmt& stmt) override
+            {
+                const auto* value = stmt.value();
+                const auto result = value != nullptr ? flatten(*value) : null_node;
+                result_ = ast_->add_stmt({.kind = StmtKind::Return, .offset = stmt.ret().offset, .first = result});
+            }
+
+        private:
+            // Offset of the expression's first token, which the parser records for expression statements. Operators
+            // & calls follow their leftmost operand, every other node starts at its own offset
+            std::uint32_t start_of(NodeIndex index) const
+            {
+                const auto& expr = ast_->expr(index);
+                switch (expr.kind) {
+                    case ExprKind::Binary:
+                    case ExprKind::Logic:
+                    case ExprKind::Call:
+                        return start_of(expr.first);
+                    case ExprKind::Unary:
+                    case ExprKind::Paren:
+                    case ExprKind::Literal:
+                    case ExprKind::Var:
+                    case ExprKind::Assignment:
+                        break;
+                }
+                return expr.offset;
+            }
+
+            FlatAst* ast_;
+            NodeIndex result_ = null_node;
+        };
+    } // namespace
+
+    FlatAst::FlatAst(std::string_view source)
+        : source_(source)
+    {
+    }
+
+    NodeIndex FlatAst::add_expr(const ExprNode& node)
+    {
+        const auto index = next_index(exprs_.size());
+        exprs_.push_back(node);
+        return index;
+    }
+
+    NodeIndex FlatAst::add_stmt(const StmtNode& node)
+    {
+        const auto index = next_index(stmts_.size());
+        stmts_.push_back(node);
+        return index;
+    }
+
+    NodeIndex FlatAst::add_number(NumberLiteral number)
+    {
+        const auto index = next_index(numbers_.size());
+        numbers_.push_back(number);
+        return index;
+    }
+
+    NodeIndex FlatAst::add_list(std::span<const NodeIndex> nodes)
+    {
+        const auto index = next_index(lists_.size());
+        lists_.push_back(next_index(nodes.size()));
+        lists_.insert(lists_.end(), nodes.begin(), nodes.end());
+        return index;
+    }
+
+    NodeIndex FlatAst::add_params(std::span<const Token> params)
+    {
+        const auto index = next_index(params_.size());
+        params_.insert(params_.end(), params.begin(), params.end());
+        return index;
+    }
+
+    void FlatAst::add_root(NodeIndex stmt)
+    {
+        roots_.push_back(stmt);
+    }
+
+    std::span<const NodeIndex> FlatAst::list(NodeIndex index) const
+    {
+        return std::span{lists_}.subspan(index + 1, lists_[index]);
+    }
+
+    std::span<const Token> FlatAst::params(NodeIndex first, NodeIndex count) const
+    {
+        return std::span{params_}.subspan(first, count);
+    }
+
+    std::size_t FlatAst::memory_usage() const
+    {
+        return exprs_.size() * sizeof(ExprNode) + stmts_.size() * sizeof(StmtNode) + numbers_.size() * sizeof(NumberLiteral) +
+               lists_.size() * sizeof(NodeIndex) + params_.size() * sizeof(Token) + roots_.size() * sizeof(NodeIndex);
+    }
+
+    FlatAst flatten(const std::vector<StmtPtr>& statements, std::string_view source)
+    {
+        auto ast = FlatAst{source};
+        auto flattener = Flattener{ast};
+        for (const auto& stmt : statements) {
+            ast.add_root(flattener.flatten(*stmt));
+        }
+        return ast;
+    }
+} // namespace lox
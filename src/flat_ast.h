@@ -0,0 +1,105 @@
+#pragma once
+
+#include "ast.h"
+#include "token.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace lox
+{
+    // Index of a node in one of the FlatAst arrays
+    using NodeIndex = std::uint32_t;
+
+    inline constexpr NodeIndex null_node = UINT32_MAX;
+
+    // Nodes don't store tokens, only the source offset (and length where the text is needed later). Every node has
+    // an offset, it is what the compiler maps to a line for the line table
+    enum class ExprKind : std::uint8_t {
+        Binary,     // op & offset: operator, first: lhs, second: rhs
+        Unary,      // op & offset: operator, first: operand
+        Paren,      // offset: opening '(', first: expression
+        Literal,    // op: literal token type, offset: literal, first: index into numbers or string length
+        Var,        // offset: identifier, first: identifier length
+        Assignment, // offset: identifier, first: value, second: identifier length
+        Logic,      // op & offset: operator, first: lhs, second: rhs
+        Call,       // offset: closing ')', first: callee, second: argument list
+    };
+
+    enum class StmtKind : std::uint8_t {
+        Expr,    // offset: start of the expression, first: expression
+        Print,   // offset: print keyword, first: expression
+        VarDecl, // offset & length: identifier, first: initializer or null_node
+        FunDecl, // offset & length: identifier, first: first parameter, second: parameter count, third: body block
+        Block,   // offset: opening '{', first: statement list
+        If,      // offset: if keyword, first: condition, second: then branch, third: else branch or null_node
+        While,   // offset: while keyword, first: condition, second: body
+        Return,  // offset: return keyword, first: value or null_node
+    };
+
+    struct ExprNode {
+        ExprKind kind;
+        TokenType op = TokenType::Eof;
+        std::uint32_t offset = 0;
+        NodeIndex first = null_node;
+        NodeIndex second = null_node;
+    };
+
+    struct StmtNode {
+        StmtKind kind;
+        std::uint32_t offset = 0;
+        std::uint32_t length = 0;
+        NodeIndex first = null_node;
+        NodeIndex second = null_node;
+        NodeIndex third = null_node;
+    };
+
+    static_assert(sizeof(ExprNode) == 16);
+
+    // AST stored in contiguous per-kind arrays, children are referred to by index instead of pointer. Text such as
+    // identifiers & string literals is read back from the source, which has to outlive the FlatAst.
+    // Nodes are only ever appended, the tree is read through expr(), stmt() and roots()
+    class FlatAst
+    {
+    public:
+        explicit FlatAst(std::string_view source);
+
+        NodeIndex add_expr(const ExprNode& node);
+        NodeIndex add_stmt(const StmtNode& node);
+        NodeIndex add_number(NumberLiteral number);
+        // Lists are stored length prefixed, see list()
+        NodeIndex add_list(std::span<const NodeIndex> nodes);
+        NodeIndex add_params(std::span<const Token> params);
+        void add_root(NodeIndex stmt);
+
+        [[nodiscard]] const ExprNode& expr(NodeIndex index) const { return exprs_[index]; }
+        [[nodiscard]] const StmtNode& stmt(NodeIndex index) const { return stmts_[index]; }
+        [[nodiscard]] NumberLiteral number(NodeIndex index) const { return numbers_[index]; }
+        [[nodiscard]] std::span<const NodeIndex> list(NodeIndex index) const;
+        [[nodiscard]] std::span<const Token> params(NodeIndex first, NodeIndex count) const;
+        [[nodiscard]] std::span<const NodeIndex> roots() const { return roots_; }
+
+        [[nodiscard]] std::string_view source() const { return source_; }
+        [[nodiscard]] std::string_view text(std::uint32_t offset, std::uint32_t length) const { return source_.substr(offset, length); }
+
+        [[nodiscard]] std::size_t node_count() const { return exprs_.size() + stmts_.size(); }
+        // Bytes held by the node arrays
+        [[nodiscard]] std::size_t memory_usage() const;
+
+    private:
+        std::string_view source_;
+        std::vector<ExprNode> exprs_;
+        std::vector<StmtNode> stmts_;
+        std::vector<NumberLiteral> numbers_;
+        std::vector<NodeIndex> lists_;
+        std::vector<Token> params_;
+        std::vector<NodeIndex> roots_;
+    };
+
+    // Adapter for code that still builds the pointer tree through the visitor API. The tree's tokens have to refer
+    // to `source`, string literals & identifiers are taken from there
+    FlatAst flatten(const std::vector<StmtPtr>& statements, std::string_view source);
+} // namespace lox
@@ -0,0 +1,218 @@
+#include "incremental_compiler.h"
+
+#include "lexer.h"
+#include "linker.h"
+#include "parser.h"
+
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <utility>
+
+namespace lox
+{
+    namespace
+    {
+        // Lexes & parses just the span, the lexer still sees the preceding source so error locations are exact
+        tl::expected<CompileOutput, std::vector<std::string>> compile_declaration(std::string_view source, DeclarationSpan span)
+        {
+            std::vector<std::string> errors;
+            auto lexer = Lexer{source.substr(0, span.end), span.begin};
+            auto parser = Parser{lexer};
+            const auto parse_result = parser.parse();
+            if (!parse_result) {
+                for (const auto& error : parse_result.error()) {
+                    errors.emplace_back(error.what());
+                }
+                return tl::unexpected(std::move(errors));
+            }
+
+            auto compiler = BytecodeCompiler{};
+            auto compile_result = compiler.compile(*parse_result);
+            if (!compile_result) {
+                errors.push_back(std::move(compile_result.error().message));
+                return tl::unexpected(std::move(errors));
+            }
+            return std::move(*compile_result);
+        }
+
+        // Splits the statements from `from` on, an offset between two statements, into `spans`. Stops before the
+        // first statement whose offset `resync` accepts and returns that offset, or returns std::nullopt at the end
+        template <typename Resync>
+        std::optional<std::uint32_t> split_from(std::string_view source, std::uint32_t from, std::vector<DeclarationSpan>& spans, Resync resync)
+        {
+            auto lexer = Lexer{source, from};
+            std::optional<std::uint32_t> begin;
+            std::uint32_t end = 0;
+            int depth = 0;
+            auto token = lexer.scan_token();
+            while (token.type != TokenType::Eof) {
+                if (!begin) {
+                    if (resync(token.offset)) {
+                        return token.offset;
+                    }
+                    begin = token.offset;
+                }
+                switch (token.type) {
+                    case TokenType::LeftParen:
+                    case TokenType::LeftBrace:
+                        ++depth;
+                        break;
+                    case TokenType::RightParen:
+                    case TokenType::RightBrace:
+                        --depth;
+                        break;
+                    default:
+                        break;
+                }
+                end = token.offset + token.length;
+                const auto closes = depth <= 0 && (token.type == TokenType::Semicolon || token.type == TokenType::RightBrace);
+
+                token = lexer.scan_token();
+                // An if statement continues past the end of its then branch
+                if (closes && token.type != TokenType::Else) {
+                    spans.push_back({*begin, end});
+                    begin.reset();
+                    depth = 0;
+                }
+            }
+            if (begin) {
+                // Unterminated statement, left for the parser to report
+                spans.push_back({*begin, end});
+            }
+            return std::nullopt;
+        }
+    } // namespace
+
+    std::vector<DeclarationSpan> split_declarations(std::string_view source)
+    {
+        std::vector<DeclarationSpan> spans;
+        split_from(source, 0, spans, [](std::uint32_t) { return false; });
+        return spans;
+    }
+
+    IncrementalResult IncrementalCompiler::compile(std::string_view source)
+    {
+        ++generation_;
+        reused_count_ = 0;
+        compiled_count_ = 0;
+        linked_count_ = 0;
+
+        split(source);
+        std::vector<std::string> errors;
+        for (auto& declaration : declarations_) {
+            if (declaration.unit != nullptr) {
+                declaration.unit->generation = generation_;
+                ++reused_count_;
+                continue;
+            }
+            const auto span = declaration.span;
+            const auto text = source.substr(span.begin, span.end - span.begin);
+            if (auto iter = cache_.find(text); iter != cache_.end()) {
+                iter->second.generation = generation_;
+                declaration.unit = &iter->second;
+                ++reused_count_;
+                continue;
+            }
+
+            auto unit = compile_declaration(source, span);
+            ++compiled_count_;
+            if (!unit) {
+                std::ranges::move(unit.error(), std::back_inserter(errors));
+                continue;
+            }
+            const auto [iter, inserted] = cache_.emplace(std::string{text}, CachedUnit{std::move(*unit), declaration.line, generation_, next_id_++});
+            declaration.unit = &iter->second;
+        }
+
+        // Drop statements that were edited or removed so the cache doesn't grow with every reload
+        std::erase_if(cache_, [this](const auto& entry) { return entry.second.generation != generation_; });
+
+        if (!errors.empty()) {
+            return tl::unexpected(std::move(errors));
+        }
+        return link_program();
+    }
+
+    void IncrementalCompiler::split(std::string_view source)
+    {
+        const auto previous = std::string_view{source_};
+        const auto prefix = static_cast<std::size_t>(std::ranges::mismatch(source, previous).in1 - source.begin());
+        const auto limit = std::min(source.size(), previous.size()) - prefix;
+        std::size_t suffix = 0;
+        while (suffix < limit && source[source.size() - suffix - 1] == previous[previous.size() - suffix - 1]) {
+            ++suffix;
+        }
+        const auto delta = static_cast<std::int64_t>(source.size()) - static_cast<std::int64_t>(previous.size());
+
+        // The first token of the next statement decides where a statement ends, so a statement is only kept if the
+        // one after it ends before the change too
+        std::size_t keep = 0;
+        while (keep + 1 < declarations_.size() && declarations_[keep + 1].span.end < prefix) {
+            ++keep;
+        }
+        // Splitting stops at the first statement that starts at the same place in the unchanged end of the source,
+        // the lexer continues the same way from there
+        auto resync = std::ranges::find_if(declarations_.begin() + static_cast<std::ptrdiff_t>(keep), declarations_.end(), [&](const Declaration& declaration) {
+            return declaration.span.begin >= previous.size() - suffix;
+        });
+        std::vector<DeclarationSpan> spans;
+        const auto resumed_at = split_from(source, keep > 0 ? declarations_[keep - 1].span.end : 0, spans, [&](std::uint32_t offset) {
+            while (resync != declarations_.end() && resync->span.begin + delta < offset) {
+                ++resync;
+            }
+            return resync != declarations_.end() && resync->span.begin + delta == offset;
+        });
+
+        // Lines are counted from the last kept statement on instead of indexing every line of the source
+        auto cursor_offset = keep > 0 ? declarations_[keep - 1].span.begin : 0;
+        auto cursor_line = keep > 0 ? declarations_[keep - 1].line : 1;
+        const auto line_at = [&](std::uint32_t offset) {
+            cursor_line += static_cast<std::uint32_t>(std::count(source.begin() + cursor_offset, source.begin() + offset, '\n'));
+            cursor_offset = offset;
+            return cursor_line;
+        };
+
+        std::vector<Declaration> declarations{declarations_.begin(), declarations_.begin() + static_cast<std::ptrdiff_t>(keep)};
+        for (const auto span : spans) {
+            declarations.push_back({.span = span, .line = line_at(span.begin)});
+        }
+        if (resumed_at) {
+            const auto line_delta = static_cast<std::int64_t>(line_at(*resumed_at)) - resync->line;
+            for (auto iter = resync; iter != declarations_.end(); ++iter) {
+                declarations.push_back({
+                    .span = {static_cast<std::uint32_t>(iter->span.begin + delta), static_cast<std::uint32_t>(iter->span.end + delta)},
+                    .line = static_cast<std::uint32_t>(iter->line + line_delta),
+                    .unit = iter->unit,
+                });
+            }
+        }
+        declarations_ = std::move(declarations);
+        source_ = source;
+    }
+
+    IncrementalResult IncrementalCompiler::link_program()
+    {
+        std::vector<LinkedUnit> units;
+        units.reserve(declarations_.size());
+        for (const auto& declaration : declarations_) {
+            units.push_back({.id = declaration.unit->id, .line = declaration.line});
+        }
+        // Units before the first one that changed or moved stay linked
+        const auto first_change = static_cast<std::size_t>(std::ranges::mismatch(units, linked_).in1 - units.begin());
+        linker_.truncate(first_change);
+        linked_.resize(std::min(first_change, linked_.size()));
+        try {
+            for (auto i = first_change; i < units.size(); ++i) {
+                const auto& cached = *declarations_[i].unit;
+                linker_.add(cached.output, static_cast<std::int64_t>(units[i].line) - cached.line);
+                linked_.push_back(units[i]);
+            }
+        } catch (const CompileError& error) {
+            linker_.truncate(linked_.size());
+            return tl::unexpected(std::vector{error.message});
+        }
+        linked_count_ = units.size() - first_change;
+        return linker_.program();
+    }
+} // namespace lox
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "bytecode_compiler.h"
+#include "linker.h"
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lox
+{
+    using IncrementalResult = tl::expected<CompileOutput, std::vector<std::string>>;
+
+    // Source range of a single top-level statement, from its first token to the end of its last one
+    struct DeclarationSpan {
+        std::uint32_t begin;
+        std::uint32_t end;
+    };
+
+    // Splits the source into top-level statements with a lexer-only pass, tracking bracket depth
+    std::vector<DeclarationSpan> split_declarations(std::string_view source);
+
+    // Compiles every top-level statement as its own unit and links them. Units are cached by their source text
+    // so recompiling an edited script only parses & compiles the statements that changed since the last call.
+    // Only the source between the first & the last changed byte is split into statements again, and the linked
+    // program is only relinked from the first statement that changed or moved to another line
+    class IncrementalCompiler
+    {
+    public:
+        IncrementalResult compile(std::string_view source);
+
+        // Statements reused from the cache & compiled from source during the last compile()
+        [[nodiscard]] auto reused_count() const { return reused_count_; }
+        [[nodiscard]] auto compiled_count() const { return compiled_count_; }
+        // Statements linked during the last compile(), the ones before them were kept from the previous program
+        [[nodiscard]] auto linked_count() const { return linked_count_; }
+
+    private:
+        struct SourceHash {
+            using is_transparent = void;
+            std::size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+        };
+
+        struct CachedUnit {
+            CompileOutput output;
+            // Line the statement started on when it was compiled, its line table is shifted when it moves
+            std::uint32_t line;
+            std::uint64_t generation;
+            // Unique over the compiler's lifetime, a unit dropped from the cache is never confused with a new one
+            std::uint64_t id;
+        };
+
+        // A top-level statement of the last compiled source
+        struct Declaration {
+            DeclarationSpan span;
+            std::uint32_t line;
+            // Null until the statement has been looked up in the cache, or if it failed to compile
+            CachedUnit* unit = nullptr;
+        };
+
+        // A unit in linker_ & the line it was linked for
+        struct LinkedUnit {
+            std::uint64_t id;
+            std::uint32_t line;
+
+            bool operator==(const LinkedUnit&) const = default;
+        };
+
+        // Replaces declarations_ with the statements of `source`, keeping the ones outside the changed range
+        void split(std::string_view source);
+        IncrementalResult link_program();
+
+        std::unordered_map<std::string, CachedUnit, SourceHash, std::equal_to<>> cache_;
+        std::string source_;
+        std::vector<Declaration> declarations_;
+        Linker linker_;
+        std::vector<LinkedUnit> linked_;
+        std::uint64_t generation_ = 0;
+        std::uint64_t next_id_ = 0;
+        std::size_t reused_count_ = 0;
+        std::size_t compiled_count_ = 0;
+        std::size_t linked_count_ = 0;
+    };
+} // namespace lox
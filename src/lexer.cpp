@@ -1,51 +1,79 @@
 #include "lexer.h"
 
 #include "error.h"
+#include "lexer_scan.h"
 
-#include <cctype>
-#include <unordered_map>
+#include <array>
+#include <cassert>
+#include <cstdint>
 
 namespace lox
 {
-    using namespace std::string_view_literals;
-    const std::unordered_map<std::string_view, TokenType> Lexer::keywords = std::unordered_map{
-        std::make_pair("and"sv, TokenType::And),
-        std::make_pair("or"sv, TokenType::Or),
-        std::make_pair("true"sv, TokenType::True),
-        std::make_pair("false"sv, TokenType::False),
-        std::make_pair("var"sv, TokenType::Var),
-        std::make_pair("fun"sv, TokenType::Fun),
-        std::make_pair("class"sv, TokenType::Class),
-        std::make_pair("if"sv, TokenType::If),
-        std::make_pair("else"sv, TokenType::Else),
-        std::make_pair("for"sv, TokenType::For),
-        std::make_pair("while"sv, TokenType::While),
-        std::make_pair("super"sv, TokenType::Super),
-        std::make_pair("nil"sv, TokenType::Nil),
-        std::make_pair("print"sv, TokenType::Print),
-        std::make_pair("return"sv, TokenType::Return),
-    };
-
-    Lexer::Lexer(std::string_view source)
+    namespace
+    {
+        // Coefficients chosen so every keyword lands in its own slot, checked when building keyword_table
+        constexpr std::size_t keyword_hash(std::string_view word)
+        {
+            const auto first = static_cast<unsigned char>(word.front());
+            const auto last = static_cast<unsigned char>(word.back());
+            return (first + last * 5 + word.size()) & 31;
+        }
+
+        struct KeywordSlot {
+            std::string_view keyword;
+            TokenType type = TokenType::Identifier;
+        };
+
+        constexpr auto keyword_table = [] {
+            std::array<KeywordSlot, 32> table{};
+            for (const auto& [keyword, type] : Lexer::keywords) {
+                auto& slot = table[keyword_hash(keyword)];
+                if (!slot.keyword.empty()) {
+                    throw "keyword hash collision, keyword_hash() needs new coefficients";
+                }
+                slot = {keyword, type};
+            }
+            return table;
+        }();
+    } // namespace
+
+    TokenType Lexer::classify_identifier(std::string_view lexeme)
+    {
+        // keyword_hash() reads the first & last character
+        if (lexeme.empty()) {
+            return TokenType::Identifier;
+        }
+        const auto& slot = keyword_table[keyword_hash(lexeme)];
+        return slot.keyword == lexeme ? slot.type : TokenType::Identifier;
+    }
+
+    Lexer::Lexer(std::string_view source, std::uint32_t start)
         : source_(source)
+        , current_position_(start)
+        , start_position_(start)
+        , line_index_(source)
     {
+        assert(source.size() <= UINT32_MAX && "token offsets are 32 bit");
+        assert(start <= source.size());
     }
 
     Token Lexer::tokenize_next()
     {
+        const auto token = scan_token();
+        if (token.type == TokenType::Error) [[unlikely]] {
+            throw_error(error_message(token));
+        }
+        return token;
+    }
+
+    Token Lexer::scan_token()
+    {
+        skip_whitespace();
         while (!is_eof()) {
             start_position_ = current_position_;
-            start_location_ = current_location_;
 
             const char c = consume();
             switch (c) {
-                case '\n':
-                    current_location_.new_line();
-                    [[fallthrough]];
-                case ' ':
-                case '\r':
-                case '\t':
-                    continue;
                 case '+':
                     return make_token(TokenType::Plus);
                 case '-':
@@ -54,9 +82,8 @@ namespace lox
                     return make_token(TokenType::Star);
                 case '/':
                     if (consume_expected('/')) {
-                        while (!is_eof() && peek() != '\n') {
-                            consume();
-                        }
+                        current_position_ = scan::find_char(source_, current_position_, '\n');
+                        skip_whitespace();
                         continue;
                     }
                     return make_token(TokenType::Slash);
@@ -97,17 +124,16 @@ namespace lox
                 case '"':
                     return make_string_literal();
                 default:
-                    if (std::isdigit(c)) {
+                    if (scan::is_digit(c)) {
                         return make_number_literal();
                     }
-                    if (std::isalpha(c) || c == '_') {
+                    if (scan::is_alpha(c)) {
                         return make_keyword_or_identifier();
                     }
-                    throw_error("Unexpected character");
+                    return make_token(TokenType::Error);
             }
         }
         start_position_ = current_position_;
-        start_location_ = current_location_;
         return make_token(TokenType::Eof);
     }
 
@@ -134,7 +160,6 @@ namespace lox
         if (is_eof()) {
             return '\0';
         }
-        current_location_.column += 1;
         return source_[current_position_++];
     }
 
@@ -170,20 +195,19 @@ namespace lox
 
     Token Lexer::make_token(TokenType type) const
     {
-        return {.type = type, .lexeme = current_lexeme(), .location = start_location_};
+        return {
+            .type = type,
+            .offset = static_cast<std::uint32_t>(start_position_),
+            .length = static_cast<std::uint32_t>(current_position_ - start_position_),
+        };
     }
 
     Token Lexer::make_string_literal()
     {
-        while (peek() != '"' && !is_eof()) {
-            if (peek() == '\n') {
-                current_location_.new_line();
-            }
-            consume();
-        }
+        current_position_ = scan::find_char(source_, current_position_, '"');
 
         if (is_eof()) {
-            throw_error("Unterminated string");
+            return make_token(TokenType::Error);
         }
 
         // Consume the terminating "
@@ -194,13 +218,13 @@ namespace lox
 
     Token Lexer::make_number_literal()
     {
-        while (std::isdigit(peek())) {
+        while (scan::is_digit(peek())) {
             consume();
         }
 
-        if (peek() == '.' && std::isdigit(peek_next())) {
+        if (peek() == '.' && scan::is_digit(peek_next())) {
             consume();
-            while (std::isdigit(peek())) {
+            while (scan::is_digit(peek())) {
                 consume();
             }
         }
@@ -210,17 +234,33 @@ namespace lox
 
     Token Lexer::make_keyword_or_identifier()
     {
-        while (std::isalnum(peek()) || peek() == '_') {
-            consume();
-        }
-        if (auto iter = keywords.find(current_lexeme()); iter != keywords.end()) {
-            return make_token(iter->second);
-        }
-        return make_token(TokenType::Identifier);
+        current_position_ = scan::identifier_end(source_, current_position_);
+        return make_token(classify_identifier(current_lexeme()));
+    }
+
+    void Lexer::skip_whitespace()
+    {
+        current_position_ = scan::skip_whitespace(source_, current_position_);
+    }
+
+    const char* Lexer::error_message(const Token& token) const
+    {
+        assert(token.type == TokenType::Error);
+        return lexeme(token).starts_with('"') ? "Unterminated string" : "Unexpected character";
+    }
+
+    std::uint32_t Lexer::error_offset(const Token& token)
+    {
+        return token.offset + token.length;
+    }
+
+    SourceLocation Lexer::location_of(std::uint32_t offset) const
+    {
+        return line_index_.locate(offset);
     }
 
     void Lexer::throw_error(const char* message) const
     {
-        throw LoxError(message, current_location_);
+        throw LoxError(message, location_of(static_cast<std::uint32_t>(current_position_)));
     }
 } // namespace lox
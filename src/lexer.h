@@ -3,8 +3,9 @@
 #include "source_location.h"
 #include "token.h"
 
+#include <array>
 #include <string_view>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace lox
@@ -12,15 +13,50 @@ namespace lox
     class Lexer
     {
     public:
-        static const std::unordered_map<std::string_view, TokenType> keywords;
+        static constexpr std::array<std::pair<std::string_view, TokenType>, 15> keywords = {{
+            {"and", TokenType::And},
+            {"or", TokenType::Or},
+            {"true", TokenType::True},
+            {"false", TokenType::False},
+            {"var", TokenType::Var},
+            {"fun", TokenType::Fun},
+            {"class", TokenType::Class},
+            {"if", TokenType::If},
+            {"else", TokenType::Else},
+            {"for", TokenType::For},
+            {"while", TokenType::While},
+            {"super", TokenType::Super},
+            {"nil", TokenType::Nil},
+            {"print", TokenType::Print},
+            {"return", TokenType::Return},
+        }};
 
-        explicit Lexer(std::string_view source);
+        // Keyword token type for the lexeme or TokenType::Identifier (also for an empty lexeme), a single perfect hash
+        // table probe
+        static TokenType classify_identifier(std::string_view lexeme);
 
+        // Lexing starts at `start`, token offsets & locations stay relative to the beginning of the source
+        explicit Lexer(std::string_view source, std::uint32_t start = 0);
+
+        // Throws a LoxError on invalid input
         Token tokenize_next();
+        // Reports invalid input as a TokenType::Error token covering the offending text instead of throwing
+        Token scan_token();
         std::vector<Token> tokenize();
 
         [[nodiscard]] bool is_eof() const;
 
+        [[nodiscard]] std::string_view source() const { return source_; }
+        [[nodiscard]] std::string_view lexeme(const Token& token) const { return token.lexeme(source_); }
+
+        // Describes the problem with a TokenType::Error token
+        [[nodiscard]] const char* error_message(const Token& token) const;
+        // Where a TokenType::Error token is reported, after the offending text
+        static std::uint32_t error_offset(const Token& token);
+
+        // Line & column of a source offset, e.g. Token::offset
+        [[nodiscard]] SourceLocation location_of(std::uint32_t offset) const;
+
     private:
         std::string_view source_;
 
@@ -35,11 +71,12 @@ namespace lox
         Token make_number_literal();
         Token make_keyword_or_identifier();
 
+        void skip_whitespace();
+
         [[noreturn]] void throw_error(const char* message) const;
 
         std::size_t current_position_ = 0;
         std::size_t start_position_ = 0;
-        SourceLocation current_location_ = {.line = 1, .column = 1};
-        SourceLocation start_location_ = {.line = 1, .column = 1};
+        LineIndex line_index_;
     };
 } // namespace lox
@@ -0,0 +1,115 @@
+#include "lexer_scan.h"
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define LOX_SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LOX_SCAN_SSE2 1
+#endif
+
+namespace lox::scan
+{
+    namespace
+    {
+#if defined(LOX_SCAN_AVX2)
+        struct Simd {
+            using Reg = __m256i;
+            static constexpr std::size_t width = 32;
+
+            static Reg load(const char* ptr) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr)); }
+            static Reg splat(char c) { return _mm256_set1_epi8(c); }
+            static Reg eq(Reg a, Reg b) { return _mm256_cmpeq_epi8(a, b); }
+            static Reg gt(Reg a, Reg b) { return _mm256_cmpgt_epi8(a, b); }
+            static Reg bit_or(Reg a, Reg b) { return _mm256_or_si256(a, b); }
+            static Reg bit_and(Reg a, Reg b) { return _mm256_and_si256(a, b); }
+            static std::uint32_t mask(Reg reg) { return static_cast<std::uint32_t>(_mm256_movemask_epi8(reg)); }
+        };
+#elif defined(LOX_SCAN_SSE2)
+        struct Simd {
+            using Reg = __m128i;
+            static constexpr std::size_t width = 16;
+
+            static Reg load(const char* ptr) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr)); }
+            static Reg splat(char c) { return _mm_set1_epi8(c); }
+            static Reg eq(Reg a, Reg b) { return _mm_cmpeq_epi8(a, b); }
+            static Reg gt(Reg a, Reg b) { return _mm_cmpgt_epi8(a, b); }
+            static Reg bit_or(Reg a, Reg b) { return _mm_or_si128(a, b); }
+            static Reg bit_and(Reg a, Reg b) { return _mm_and_si128(a, b); }
+            static std::uint32_t mask(Reg reg) { return static_cast<std::uint32_t>(_mm_movemask_epi8(reg)); }
+        };
+#endif
+
+#if defined(LOX_SCAN_AVX2) || defined(LOX_SCAN_SSE2)
+        constexpr std::uint32_t full_mask = Simd::width == 32 ? UINT32_MAX : (1u << Simd::width) - 1;
+
+        // Signed byte compare, bytes >= 0x80 are negative and never fall in an ASCII range
+        Simd::Reg in_range(Simd::Reg chunk, char first, char last)
+        {
+            return Simd::bit_and(Simd::gt(chunk, Simd::splat(static_cast<char>(first - 1))), Simd::gt(Simd::splat(static_cast<char>(last + 1)), chunk));
+        }
+
+        // Advances `from` over full vectors while every byte matches `matches`. Returns the offset of the first
+        // non matching byte, or the offset where scalar code has to take over
+        template<typename Matcher>
+        std::size_t vector_skip(std::string_view source, std::size_t from, Matcher matches)
+        {
+            while (from + Simd::width <= source.size()) {
+                const auto mismatch = ~Simd::mask(matches(Simd::load(source.data() + from))) & full_mask;
+                if (mismatch != 0) {
+                    return from + std::countr_zero(mismatch);
+                }
+                from += Simd::width;
+            }
+            return from;
+        }
+#endif
+    } // namespace
+
+    std::size_t skip_whitespace(std::string_view source, std::size_t from)
+    {
+#if defined(LOX_SCAN_AVX2) || defined(LOX_SCAN_SSE2)
+        from = vector_skip(source, from, [](Simd::Reg chunk) {
+            const auto spaces = Simd::bit_or(Simd::eq(chunk, Simd::splat(' ')), Simd::eq(chunk, Simd::splat('\t')));
+            const auto newlines = Simd::bit_or(Simd::eq(chunk, Simd::splat('\n')), Simd::eq(chunk, Simd::splat('\r')));
+            return Simd::bit_or(spaces, newlines);
+        });
+#endif
+        while (from < source.size() && is_whitespace(source[from])) {
+            ++from;
+        }
+        return from;
+    }
+
+    std::size_t find_char(std::string_view source, std::size_t from, char c)
+    {
+#if defined(LOX_SCAN_AVX2) || defined(LOX_SCAN_SSE2)
+        const auto needle = Simd::splat(c);
+        from = vector_skip(source, from, [needle](Simd::Reg chunk) {
+            return Simd::eq(Simd::eq(chunk, needle), Simd::splat(0));
+        });
+#endif
+        while (from < source.size() && source[from] != c) {
+            ++from;
+        }
+        return from;
+    }
+
+    std::size_t identifier_end(std::string_view source, std::size_t from)
+    {
+#if defined(LOX_SCAN_AVX2) || defined(LOX_SCAN_SSE2)
+        from = vector_skip(source, from, [](Simd::Reg chunk) {
+            const auto letters = Simd::bit_or(in_range(chunk, 'a', 'z'), in_range(chunk, 'A', 'Z'));
+            const auto digits = Simd::bit_or(in_range(chunk, '0', '9'), Simd::eq(chunk, Simd::splat('_')));
+            return Simd::bit_or(letters, digits);
+        });
+#endif
+        while (from < source.size() && is_alnum(source[from])) {
+            ++from;
+        }
+        return from;
+    }
+} // namespace lox::scan
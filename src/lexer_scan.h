@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Bulk scanning kernels used by the Lexer to skip over whitespace, comments, string literals & identifiers.
+// Uses AVX2 or SSE2 when the target supports it, with a scalar fallback for the tail & other targets
+namespace lox::scan
+{
+    constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+    constexpr bool is_alpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+    constexpr bool is_alnum(char c) { return is_alpha(c) || is_digit(c); }
+    constexpr bool is_whitespace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+    // Offset of the first non whitespace character at or after `from`, or source.size()
+    std::size_t skip_whitespace(std::string_view source, std::size_t from);
+    // Offset of the first occurrence of `c` at or after `from`, or source.size()
+    std::size_t find_char(std::string_view source, std::size_t from, char c);
+    // Offset of the first character at or after `from` that can't be part of an identifier, or source.size()
+    std::size_t identifier_end(std::string_view source, std::size_t from);
+} // namespace lox::scan
@@ -0,0 +1,121 @@
+#include "line_sampler.h"
+
+#include <fmt/format.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <csignal>
+    #include <sys/time.h>
+    #define LOX_HAS_ITIMER 1
+#endif
+
+namespace lox
+{
+#if defined(LOX_HAS_ITIMER)
+    namespace
+    {
+        // Flag of the running sampler, the signal handler can't be given any state
+        std::atomic<std::atomic<bool>*> running_sampler_flag = nullptr;
+
+        void on_profiling_signal(int)
+        {
+            if (auto* flag = running_sampler_flag.load(std::memory_order_relaxed)) {
+                flag->store(true, std::memory_order_relaxed);
+            }
+        }
+
+        itimerval profiling_timer(std::chrono::microseconds interval)
+        {
+            auto timer = itimerval{};
+            timer.it_interval.tv_sec = static_cast<time_t>(interval.count() / 1'000'000);
+            timer.it_interval.tv_usec = static_cast<suseconds_t>(interval.count() % 1'000'000);
+            timer.it_value = timer.it_interval;
+            return timer;
+        }
+    } // namespace
+#endif
+
+    LineSampler::LineSampler(std::chrono::microseconds interval)
+        : interval_(interval)
+    {
+    }
+
+    bool LineSampler::start()
+    {
+        if (running_) {
+            return true;
+        }
+#if defined(LOX_HAS_ITIMER)
+        std::atomic<bool>* expected = nullptr;
+        if (!running_sampler_flag.compare_exchange_strong(expected, &sample_requested_)) {
+            return false;
+        }
+        struct sigaction action = {};
+        action.sa_handler = on_profiling_signal;
+        // Interrupted system calls, e.g. the write of a print, are restarted
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        // The host's handler & timer, e.g. another profiler's, are restored by stop()
+        ::sigaction(SIGPROF, &action, &previous_action_);
+        const auto timer = profiling_timer(interval_);
+        ::setitimer(ITIMER_PROF, &timer, &previous_timer_);
+#else
+        timer_ = std::jthread{[this](std::stop_token stop) {
+            while (!stop.stop_requested()) {
+                std::this_thread::sleep_for(interval_);
+                sample_requested_.store(true, std::memory_order_relaxed);
+            }
+        }};
+#endif
+        running_ = true;
+        return true;
+    }
+
+    void LineSampler::stop()
+    {
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+#if defined(LOX_HAS_ITIMER)
+        ::setitimer(ITIMER_PROF, &previous_timer_, nullptr);
+        ::sigaction(SIGPROF, &previous_action_, nullptr);
+        running_sampler_flag.store(nullptr);
+#else
+        timer_.request_stop();
+        timer_.join();
+#endif
+        sample_requested_.store(false, std::memory_order_relaxed);
+    }
+
+    void LineSampler::record(std::uint32_t line)
+    {
+        sample_requested_.store(false, std::memory_order_relaxed);
+        ++counts_[line];
+        ++total_;
+    }
+
+    void LineSampler::clear()
+    {
+        counts_.clear();
+        total_ = 0;
+    }
+
+    std::uint64_t LineSampler::samples(std::uint32_t line) const
+    {
+        const auto iter = counts_.find(line);
+        return iter != counts_.end() ? iter->second : 0;
+    }
+
+    std::string LineSampler::folded(std::string_view script) const
+    {
+        std::string stacks;
+        for (const auto& [line, count] : counts_) {
+            if (line == 0) {
+                stacks += fmt::format("{};{}:? {}\n", script, script, count);
+            } else {
+                stacks += fmt::format("{};{}:{} {}\n", script, script, line, count);
+            }
+        }
+        return stacks;
+    }
+} // namespace lox
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <csignal>
+    #include <sys/time.h>
+#endif
+
+namespace lox
+{
+    // Samples the source line a VM is executing at a fixed interval of CPU time. A SIGPROF timer only raises a flag,
+    // the VM checks it between instructions & records the line itself. The signal keeps the process single threaded,
+    // a second thread would make every shared_ptr copy in the VM atomic & skew the profile. Only one sampler can run
+    // at a time, the host's SIGPROF handler & timer are restored when it stops. Without setitimer() a background
+    // thread raises the flag instead. Lines come from CompileOutput::lines, see VM::set_line_sampler()
+    class LineSampler
+    {
+    public:
+        static constexpr std::chrono::microseconds default_interval{1000};
+
+        // Samples while in scope, a null sampler is ignored
+        class Session
+        {
+        public:
+            explicit Session(LineSampler* sampler)
+                : sampler_(sampler)
+            {
+                if (sampler_ != nullptr && !sampler_->start()) {
+                    sampler_ = nullptr;
+                }
+            }
+            ~Session()
+            {
+                if (sampler_ != nullptr) {
+                    sampler_->stop();
+                }
+            }
+
+            Session(const Session&) = delete;
+            Session& operator=(const Session&) = delete;
+
+            // False if no sampler was given or it couldn't start
+            [[nodiscard]] bool sampling() const { return sampler_ != nullptr; }
+
+        private:
+            LineSampler* sampler_;
+        };
+
+        explicit LineSampler(std::chrono::microseconds interval = default_interval);
+        ~LineSampler() { stop(); }
+
+        LineSampler(const LineSampler&) = delete;
+        LineSampler& operator=(const LineSampler&) = delete;
+
+        // False if another sampler is running, see the class comment. Starting a running sampler succeeds
+        [[nodiscard]] bool start();
+        void stop();
+
+        [[nodiscard]] bool sample_due() const { return sample_requested_.load(std::memory_order_relaxed); }
+        // Counts a sample for `line` (0 if unknown) & clears the pending request
+        void record(std::uint32_t line);
+        void clear();
+
+        [[nodiscard]] std::uint64_t samples(std::uint32_t line) const;
+        [[nodiscard]] std::uint64_t total_samples() const { return total_; }
+
+        // Flamegraph compatible folded stacks, one "<script>;<script>:<line> <count>" entry per sampled line
+        [[nodiscard]] std::string folded(std::string_view script) const;
+
+    private:
+        std::chrono::microseconds interval_;
+        std::atomic<bool> sample_requested_ = false;
+        bool running_ = false;
+#if defined(__unix__) || defined(__APPLE__)
+        struct sigaction previous_action_ = {};
+        itimerval previous_timer_ = {};
+#else
+        std::jthread timer_;
+#endif
+        std::map<std::uint32_t, std::uint64_t> counts_;
+        std::uint64_t total_ = 0;
+    };
+} // namespace lox
@@ -0,0 +1,143 @@
+#include "line_table.h"
+
+#include <cassert>
+#include <utility>
+
+namespace lox
+{
+    namespace
+    {
+        void write_varint(std::vector<std::uint8_t>& bytes, std::uint64_t value)
+        {
+            while (value >= 0x80) {
+                bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            bytes.push_back(static_cast<std::uint8_t>(value));
+        }
+
+        std::uint64_t read_varint(const std::uint8_t*& bytes)
+        {
+            std::uint64_t value = 0;
+            for (int shift = 0;; shift += 7) {
+                const auto byte = *bytes++;
+                value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+                if ((byte & 0x80) == 0) {
+                    return value;
+                }
+            }
+        }
+
+        // Small deltas in either direction encode to small values
+        std::uint64_t zigzag(std::int64_t value)
+        {
+            return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+        }
+
+        std::int64_t unzigzag(std::uint64_t value)
+        {
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+        }
+
+        // Calls `visit` with every run in order until it returns true
+        template <typename Visitor>
+        void decode(const std::vector<std::uint8_t>& bytes, const LineRun& last, Visitor visit)
+        {
+            std::int64_t line = 0;
+            std::uint32_t file = 0;
+            const auto* iter = bytes.data();
+            const auto* end = iter + bytes.size();
+            while (iter != end) {
+                const auto length_and_flag = read_varint(iter);
+                line += unzigzag(read_varint(iter));
+                if ((length_and_flag & 1) != 0) {
+                    file = static_cast<std::uint32_t>(read_varint(iter));
+                }
+                const auto length = static_cast<std::uint32_t>(length_and_flag >> 1);
+                if (visit(LineRun{.line = static_cast<std::uint32_t>(line), .length = length, .file = file})) {
+                    return;
+                }
+            }
+            if (last.length > 0) {
+                visit(last);
+            }
+        }
+    } // namespace
+
+    void LineTable::add(std::uint32_t line, std::uint32_t length, std::uint32_t file)
+    {
+        if (length == 0) {
+            return;
+        }
+        if (last_.length > 0 && last_.line == line && last_.file == file) {
+            last_.length += length;
+            return;
+        }
+        if (last_.length > 0) {
+            encode(last_);
+        }
+        last_ = {.line = line, .length = length, .file = file};
+    }
+
+    void LineTable::append(const LineTable& other, std::int64_t line_delta, std::uint32_t file)
+    {
+        decode(other.bytes_, other.last_, [this, line_delta, file](const LineRun& run) {
+            add(static_cast<std::uint32_t>(run.line + line_delta), run.length, file);
+            return false;
+        });
+    }
+
+    void LineTable::shift_lines(std::int64_t delta)
+    {
+        auto shifted = LineTable{};
+        for (const auto& run : runs()) {
+            shifted.add(static_cast<std::uint32_t>(run.line + delta), run.length, run.file);
+        }
+        *this = std::move(shifted);
+    }
+
+    void LineTable::rewind(const Mark& mark)
+    {
+        assert(mark.size <= bytes_.size() && "mark is newer than the table");
+        bytes_.resize(mark.size);
+        encoded_line_ = mark.encoded_line;
+        encoded_file_ = mark.encoded_file;
+        last_ = mark.last;
+    }
+
+    LineRun LineTable::run_at(std::size_t offset) const
+    {
+        auto found = LineRun{.line = 0, .length = 0};
+        decode(bytes_, last_, [&](const LineRun& run) {
+            if (offset < run.length) {
+                found = run;
+                return true;
+            }
+            offset -= run.length;
+            return false;
+        });
+        return found;
+    }
+
+    std::vector<LineRun> LineTable::runs() const
+    {
+        std::vector<LineRun> runs;
+        decode(bytes_, last_, [&runs](const LineRun& run) {
+            runs.push_back(run);
+            return false;
+        });
+        return runs;
+    }
+
+    void LineTable::encode(const LineRun& run)
+    {
+        const auto file_changed = run.file != encoded_file_;
+        write_varint(bytes_, (static_cast<std::uint64_t>(run.length) << 1) | (file_changed ? 1 : 0));
+        write_varint(bytes_, zigzag(static_cast<std::int64_t>(run.line) - encoded_line_));
+        if (file_changed) {
+            write_varint(bytes_, run.file);
+        }
+        encoded_line_ = run.line;
+        encoded_file_ = run.file;
+    }
+} // namespace lox
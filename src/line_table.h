@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lox
+{
+    // Consecutive code bytes compiled from the same source line
+    struct LineRun {
+        std::uint32_t line;
+        std::uint32_t length;
+        // Index into CompileOutput::files, for programs linked from several files
+        std::uint32_t file = 0;
+
+        constexpr bool operator==(const LineRun&) const = default;
+    };
+
+    // Map from code offsets to source lines, stored next to the bytecode instead of in it. Runs are encoded as a
+    // varint code length followed by a zigzag varint line delta to the previous run, typically 2 bytes per line
+    // change. The length's low bit flags a change of file, the run's file index then follows as a varint. Nothing reads the table while code runs, it is only decoded for profiling & error locations.
+    // Offsets count from the first instruction, i.e. the constants prefix is not part of the table
+    class LineTable
+    {
+    public:
+        // State of the table at some point, see rewind()
+        struct Mark {
+            std::size_t size;
+            std::uint32_t encoded_line;
+            std::uint32_t encoded_file;
+            LineRun last;
+        };
+
+        // Attributes the next `length` code bytes to `line` of `file`, extending the last run if it is on the same
+        // line
+        void add(std::uint32_t line, std::uint32_t length, std::uint32_t file = 0);
+        // Appends the table of code placed directly after the code this table covers, moving its runs by
+        // `line_delta` lines & attributing them to `file`
+        void append(const LineTable& other, std::int64_t line_delta = 0, std::uint32_t file = 0);
+        // Moves every run by `delta` lines, e.g. when cached code is reused for source that moved
+        void shift_lines(std::int64_t delta);
+        // Runs are only ever appended, so dropping the ones added since a mark is constant time
+        [[nodiscard]] Mark mark() const
+        {
+            return {.size = bytes_.size(), .encoded_line = encoded_line_, .encoded_file = encoded_file_, .last = last_};
+        }
+        void rewind(const Mark& mark);
+
+        // Line of the code byte at `offset`, 0 if the offset isn't covered by the table
+        [[nodiscard]] std::uint32_t line_at(std::size_t offset) const { return run_at(offset).line; }
+        // Run covering the code byte at `offset`, with line 0 if the offset isn't covered by the table
+        [[nodiscard]] LineRun run_at(std::size_t offset) const;
+        [[nodiscard]] std::vector<LineRun> runs() const;
+        // Encoded size, the last run is only encoded once a run on another line is added
+        [[nodiscard]] std::size_t size_bytes() const { return bytes_.size(); }
+
+    private:
+        void encode(const LineRun& run);
+
+        std::vector<std::uint8_t> bytes_;
+        std::uint32_t encoded_line_ = 0;
+        std::uint32_t encoded_file_ = 0;
+        LineRun last_ = {.line = 0, .length = 0};
+    };
+} // namespace lox
@@ -0,0 +1,112 @@
+#include "linker.h"
+
+#include "bytecode.h"
+#include "vm_instruction.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace lox
+{
+    namespace
+    {
+        bool refers_to_constant(Instruction instruction)
+        {
+            switch (instruction) {
+                case Instruction::PushConstant:
+                case Instruction::DefineGlobal:
+                case Instruction::SetGlobal:
+                case Instruction::GetGlobal:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // Moves the unit's constants into the merged pool, returning the new index of each constant
+        std::vector<std::uint8_t> merge_constants(Bytecode& bytecode, ConstantPool& pool)
+        {
+            std::vector<std::uint8_t> remap;
+            while (!bytecode.is_eof() && bytecode.peek() == '@') {
+                bytecode.read(); // consume @
+                const auto index = bytecode.read();
+                const auto type = bytecode.read();
+                if (remap.size() <= index) {
+                    remap.resize(index + 1);
+                }
+                switch (type) {
+                    case 'd':
+                        remap[index] = pool.add_number(bytecode.read_number());
+                        break;
+                    case 's':
+                        remap[index] = pool.add_string(bytecode.read_string());
+                        break;
+                }
+            }
+            return remap;
+        }
+    } // namespace
+
+    void Linker::add(const CompileOutput& unit, std::int64_t line_delta, std::uint32_t file)
+    {
+        marks_.push_back({.constants = pool_.mark(), .code_size = code_.size(), .lines = lines_.mark(), .max_stack_depth = max_stack_depth_});
+        auto bytecode = Bytecode{unit.bytecode};
+        const auto remap = merge_constants(bytecode, pool_);
+        // Jumps are relative so code can be copied as is, only constant operands change
+        while (!bytecode.is_eof()) {
+            const auto instruction = bytecode.fetch();
+            code_.push_back(static_cast<std::uint8_t>(instruction));
+            if (refers_to_constant(instruction)) {
+                code_.push_back(remap[bytecode.read()]);
+                continue;
+            }
+            for (int i = 0; i < operand_size(instruction); ++i) {
+                code_.push_back(bytecode.read());
+            }
+        }
+        // Operand sizes don't change either, so the unit's line runs still line up with the copied code
+        lines_.append(unit.lines, line_delta, file);
+        // Every unit starts & ends with an empty stack, so units never add up
+        max_stack_depth_ = std::max(max_stack_depth_, unit.max_stack_depth);
+    }
+
+    void Linker::truncate(std::size_t count)
+    {
+        if (count >= marks_.size()) {
+            return;
+        }
+        const auto& mark = marks_[count];
+        pool_.rewind(mark.constants);
+        code_.resize(mark.code_size);
+        lines_.rewind(mark.lines);
+        max_stack_depth_ = mark.max_stack_depth;
+        marks_.resize(count);
+    }
+
+    CompileOutput Linker::program() const
+    {
+        const auto& constants = pool_.bytes();
+        std::vector<std::uint8_t> bytecode;
+        bytecode.reserve(constants.size() + code_.size());
+        bytecode.insert(bytecode.end(), constants.begin(), constants.end());
+        bytecode.insert(bytecode.end(), code_.begin(), code_.end());
+        return CompileOutput{.bytecode = std::move(bytecode), .max_stack_depth = max_stack_depth_, .lines = lines_};
+    }
+
+    CompileResult link(std::span<const CompileOutput> units, std::span<const std::string> files)
+    {
+        try {
+            auto linker = Linker{};
+            for (std::uint32_t i = 0; i < units.size(); ++i) {
+                linker.add(units[i], 0, i < files.size() ? i : 0);
+            }
+            auto program = linker.program();
+            program.files.assign(files.begin(), files.end());
+            return program;
+        } catch (const CompileError& err) {
+            return tl::unexpected(err);
+        }
+    }
+} // namespace lox
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "bytecode_compiler.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace lox
+{
+    // Links units one at a time, in the order they are added. Units added last can be dropped again, so a program
+    // that changed towards its end only has to be relinked from the first changed unit on
+    class Linker
+    {
+    public:
+        // Throws CompileError when the merged constants don't fit in a single pool. The unit's lines are moved by
+        // `line_delta`, e.g. for cached code of a statement that moved, & attributed to `file`
+        void add(const CompileOutput& unit, std::int64_t line_delta = 0, std::uint32_t file = 0);
+        // Keeps the first `count` units
+        void truncate(std::size_t count);
+
+        [[nodiscard]] std::size_t size() const { return marks_.size(); }
+        [[nodiscard]] CompileOutput program() const;
+
+    private:
+        // State before each unit was added
+        struct Mark {
+            ConstantPool::Mark constants;
+            std::size_t code_size;
+            LineTable::Mark lines;
+            std::size_t max_stack_depth;
+        };
+
+        ConstantPool pool_;
+        std::vector<std::uint8_t> code_;
+        LineTable lines_;
+        std::size_t max_stack_depth_ = 0;
+        std::vector<Mark> marks_;
+    };
+
+    // Joins independently compiled units into a single program, in the given order. Constants (including global
+    // names) are merged into one deduplicated pool and the operands referring to them are remapped. Each unit's
+    // lines are attributed to the file at the unit's index in `files`, the program keeps the names
+    CompileResult link(std::span<const CompileOutput> units, std::span<const std::string> files = {});
+} // namespace lox
@@ -1,50 +1,99 @@
 #include "lox.h"
 
+#include "bundle.h"
 #include "bytecode_compiler.h"
 #include "disassembler.h"
 #include "error.h"
 #include "lexer.h"
 #include "parser.h"
+#include "source_file.h"
 
-#include <cstdio>
-#include <string>
+#include <string_view>
 
 #include <fmt/core.h>
 #include <fmt/ranges.h>
 
 namespace lox
 {
+    namespace
+    {
+        std::uint64_t count_tokens(std::string_view source)
+        {
+            auto lexer = Lexer{source};
+            std::uint64_t count = 0;
+            while (lexer.scan_token().type != TokenType::Eof) {
+                ++count;
+            }
+            return count;
+        }
+    } // namespace
+
     void Lox::run_file(const char* filename)
     {
-        std::FILE* fp = std::fopen(filename, "r");
-        if (fp == nullptr) {
-            std::perror(filename);
+        const auto source = SourceFile::open(filename);
+        if (!source) {
+            fmt::println(stderr, "{}", source.error());
             return;
         }
 
-        std::fseek(fp, 0, SEEK_END);
-        const auto size = std::ftell(fp);
-        std::fseek(fp, 0, SEEK_SET);
+        if (!incremental_) {
+            run_string(source->text());
+            return;
+        }
 
-        std::string source(size, ' ');
-        if (std::fread(source.data(), sizeof(char), size, fp) < size) {
-            if (std::ferror(fp)) {
-                std::perror("I/O error");
-                return;
+        const auto program = [&] {
+            const auto compiling = PhaseTimings::Scope{phase_timings_, Phase::Compile};
+            return incremental_compiler_.compile(source->text());
+        }();
+        if (!program) {
+            for (const auto& error : program.error()) {
+                fmt::println(stderr, "{}", error);
+            }
+            return;
+        }
+
+        try {
+            execute(*program);
+        } catch (const LoxError& error) {
+            fmt::println(stderr, "{}", error.what());
+        }
+    }
+
+    void Lox::run_bundle(std::span<const std::string> filenames)
+    {
+        const auto program = [&] {
+            const auto compiling = PhaseTimings::Scope{phase_timings_, Phase::Compile};
+            return load_bundle(filenames);
+        }();
+        if (!program) {
+            for (const auto& error : program.error()) {
+                fmt::println(stderr, "{}", error);
             }
+            return;
         }
 
-        run_string(source);
+        try {
+            execute(*program);
+        } catch (const LoxError& error) {
+            fmt::println(stderr, "{}", error.what());
+        }
     }
 
-    void Lox::run_string(const std::string& source)
+    void Lox::run_string(std::string_view source)
     {
         try {
-            auto lexer = Lexer{source};
-            const auto tokens = lexer.tokenize();
+            if (phase_timings_ != nullptr) {
+                // The parser pulls tokens from the lexer as it goes, a separate pass measures lexing on its own
+                const auto lexing = PhaseTimings::Scope{phase_timings_, Phase::Lex};
+                phase_timings_->add_items(Phase::Lex, count_tokens(source));
+            }
 
-            auto parser = Parser{tokens};
-            const auto parse_result = parser.parse();
+            const auto parse_result = [&] {
+                const auto parsing = PhaseTimings::Scope{phase_timings_, Phase::Parse};
+                auto lexer = Lexer{source};
+                auto parser = Parser{lexer};
+                return parser.parse();
+            }();
             if (!parse_result.has_value()) {
                 const auto& errors = parse_result.error();
                 for (const auto& error : errors) {
@@ -54,19 +103,45 @@ namespace lox
             }
 
             const auto& statements = *parse_result;
-            auto compiler = BytecodeCompiler{};
-            auto compile_result = compiler.compile(statements);
+            auto compile_result = [&] {
+                const auto compiling = PhaseTimings::Scope{phase_timings_, Phase::Compile};
+                auto compiler = BytecodeCompiler{};
+                return compiler.compile(statements);
+            }();
             if (!compile_result) {
                 fmt::println("Failed to compile to bytecode: {}", compile_result.error().message);
                 return;
             }
+            if (phase_timings_ != nullptr) {
+                phase_timings_->add_items(Phase::Parse, statements.node_count());
+                phase_timings_->add_items(Phase::Compile, count_instructions(compile_result->bytecode));
+            }
 
-            const auto& bytecode = compile_result->bytecode;
-            fmt::print("Generated {} bytes of bytecode:\n", bytecode.size());
-            fmt::println("{}", disassemble(bytecode));
-            vm_.execute(bytecode);
+            execute(*compile_result);
         } catch (const LoxError& error) {
             fmt::println(stderr, "{}", error.what());
         }
     }
+
+    void Lox::execute(const CompileOutput& program)
+    {
+        fmt::print("Generated {} bytes of bytecode (max stack depth {}):\n", program.bytecode.size(), program.max_stack_depth);
+        fmt::println("{}", disassemble(program.bytecode));
+        const auto sampling = LineSampler::Session{line_sampler_};
+        if (line_sampler_ != nullptr && !sampling.sampling()) {
+            fmt::println(stderr, "Line sampling unavailable, another LineSampler is running");
+        }
+        const auto checkpoints_before = vm_.checkpoints_passed();
+        {
+            const auto executing = PhaseTimings::Scope{phase_timings_, Phase::Execute};
+            if (perf_map_ != nullptr) {
+                perf_map_->run(perf_symbol_, [&] { vm_.execute(program); });
+            } else {
+                vm_.execute(program);
+            }
+        }
+        if (phase_timings_ != nullptr) {
+            phase_timings_->add_items(Phase::Execute, vm_.checkpoints_passed() - checkpoints_before);
+        }
+    }
 } // namespace lox
@@ -1,18 +1,62 @@
 #pragma once
 
+#include "incremental_compiler.h"
+#include "perf_map.h"
+#include "phase_timings.h"
 #include "vm.h"
 
+#include <span>
 #include <string>
+#include <string_view>
 
 namespace lox
 {
     class Lox
     {
     public:
+        // In incremental mode run_file() only recompiles the top-level statements changed since the last run, see
+        // lox-cxx --watch
+        void set_incremental(bool incremental) { incremental_ = incremental; }
+        // Samples the executing source line while programs run, pass nullptr to stop sampling
+        void set_line_sampler(LineSampler* sampler)
+        {
+            line_sampler_ = sampler;
+            vm_.set_line_sampler(sampler);
+        }
+
         void run_file(const char* filename);
-        void run_string(const std::string& string);
+        // Compiles the files concurrently and runs them as a single program
+        void run_bundle(std::span<const std::string> filenames);
+        void run_string(std::string_view source);
+
+        // Records or replays the executed branches, see VM::set_branch_observer()
+        void set_branch_observer(BranchObserver* observer) { vm_.set_branch_observer(observer); }
+        void enable_allocation_stats() { vm_.enable_allocation_stats(); }
+        // Adds the phases of every following run to the timings, pass nullptr to stop. Bundles & incremental
+        // runs count their whole front end as Phase::Compile. Execution runs the uninstrumented dispatch loop unless
+        // something else attached to the VM needs another one
+        void set_phase_timings(PhaseTimings* timings) { phase_timings_ = timings; }
+        // Runs programs below a trampoline named "lox::<script>" for perf, pass nullptr to stop
+        void set_perf_map(PerfMap* perf_map, std::string_view script)
+        {
+            perf_map_ = perf_map;
+            perf_symbol_ = "lox::" + std::string{script};
+        }
+        [[nodiscard]] auto& allocation_stats() const { return vm_.stats(); }
+
+#if defined(LOX_PROFILE_OPS)
+        [[nodiscard]] auto& op_profile() const { return vm_.op_profile(); }
+#endif
 
     private:
+        void execute(const CompileOutput& program);
+
         VM vm_;
+        bool incremental_ = false;
+        LineSampler* line_sampler_ = nullptr;
+        PerfMap* perf_map_ = nullptr;
+        PhaseTimings* phase_timings_ = nullptr;
+        std::string perf_symbol_;
+        IncrementalCompiler incremental_compiler_;
     };
 } // namespace lox
@@ -18,13 +18,13 @@ namespace lox
 
     std::unique_ptr<LoxObject> LoxNumber::negate()
     {
-        return std::make_unique<LoxNumber>(value_);
+        return make_object<LoxNumber>(value_);
     }
 
     std::unique_ptr<LoxObject> LoxNumber::subtract(const LoxObject* other)
     {
         if (const auto* rhs = dynamic_cast<const LoxNumber*>(other)) {
-            return std::make_unique<LoxNumber>(value_ - rhs->value_);
+            return make_object<LoxNumber>(value_ - rhs->value_);
         }
         return nullptr;
     }
@@ -32,7 +32,7 @@ namespace lox
     std::unique_ptr<LoxObject> LoxNumber::add(const LoxObject* other)
     {
         if (const auto* rhs = dynamic_cast<const LoxNumber*>(other)) {
-            return std::make_unique<LoxNumber>(value_ + rhs->value_);
+            return make_object<LoxNumber>(value_ + rhs->value_);
         }
         return nullptr;
     }
@@ -40,7 +40,7 @@ namespace lox
     std::unique_ptr<LoxObject> LoxNumber::multiply(const LoxObject* other)
     {
         if (const auto* rhs = dynamic_cast<const LoxNumber*>(other)) {
-            return std::make_unique<LoxNumber>(value_ * rhs->value_);
+            return make_object<LoxNumber>(value_ * rhs->value_);
         }
         return nullptr;
     }
@@ -51,7 +51,7 @@ namespace lox
             if (rhs->value_ == 0.0) {
                 throw LoxError{"divide by 0", {}};
             }
-            return std::make_unique<LoxNumber>(value_ / rhs->value_);
+            return make_object<LoxNumber>(value_ / rhs->value_);
         }
         return nullptr;
     }
@@ -1,7 +1,27 @@
 #include "lox_object.h"
 
+#include <new>
+
 namespace lox
 {
+#if defined(LOX_ALLOCATION_STATS)
+    void* LoxObject::operator new(std::size_t size)
+    {
+        if (auto* stats = AllocationStats::active()) [[unlikely]] {
+            stats->record_allocation(size);
+        }
+        return ::operator new(size);
+    }
+
+    void LoxObject::operator delete(void* object, std::size_t size)
+    {
+        if (auto* stats = AllocationStats::active()) [[unlikely]] {
+            stats->record_free(size);
+        }
+        ::operator delete(object, size);
+    }
+#endif
+
     std::unique_ptr<LoxObject> LoxObject::negate()
     {
         return nullptr;
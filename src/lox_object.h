@@ -1,8 +1,12 @@
 #pragma once
 
+#include "allocation_stats.h"
+
+#include <cstddef>
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 
 namespace lox
 {
@@ -12,6 +16,12 @@ namespace lox
         LoxObject() = default;
         virtual ~LoxObject() = default;
 
+#if defined(LOX_ALLOCATION_STATS)
+        // Account allocations in the thread's active AllocationStats, if any
+        static void* operator new(std::size_t size);
+        static void operator delete(void* object, std::size_t size);
+#endif
+
         [[nodiscard]] virtual const char* type_name() const = 0;
         [[nodiscard]] virtual bool is_truthy() const { return true; }
         // TODO: Return a reference so objects can cache string formatting results
@@ -36,4 +46,33 @@ namespace lox
     };
 
     using LoxObjectRef = std::shared_ptr<LoxObject>;
+
+    // Allocates objects created at runtime, attributing them to their type in the active AllocationStats
+    template <typename T, typename... Args>
+    std::unique_ptr<T> make_object(Args&&... args)
+    {
+        auto object = std::make_unique<T>(std::forward<Args>(args)...);
+#if defined(LOX_ALLOCATION_STATS)
+        if (auto* stats = AllocationStats::active()) [[unlikely]] {
+            stats->record_type(object->type_name(), sizeof(T));
+        }
+#endif
+        return object;
+    }
+
+    // make_object() for objects shared from the start, e.g. constants. std::make_shared keeps the single allocation
+    // for object & control block but bypasses LoxObject's operator new, so the allocation is recorded here. Its free
+    // isn't, the object is counted as live from then on
+    template <typename T, typename... Args>
+    std::shared_ptr<T> make_shared_object(Args&&... args)
+    {
+        auto object = std::make_shared<T>(std::forward<Args>(args)...);
+#if defined(LOX_ALLOCATION_STATS)
+        if (auto* stats = AllocationStats::active()) [[unlikely]] {
+            stats->record_allocation(sizeof(T));
+            stats->record_type(object->type_name(), sizeof(T));
+        }
+#endif
+        return object;
+    }
 } // namespace lox
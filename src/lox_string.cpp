@@ -10,7 +10,7 @@ namespace lox
     std::unique_ptr<LoxObject> LoxString::add(const LoxObject* other)
     {
         if (const auto* rhs = dynamic_cast<const LoxString*>(other)) {
-            return std::make_unique<LoxString>(value_ + rhs->value_);
+            return make_object<LoxString>(value_ + rhs->value_);
         }
         return nullptr;
     }
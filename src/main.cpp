@@ -1,19 +1,150 @@
 #include "lox.h"
+#include "trace.h"
 
+#if defined(LOX_COUNT_ALLOCATIONS)
+#include "allocation_counter.h"
+#endif
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 int main(int argc, const char* argv[])
 {
-    if (argc > 2) {
-        std::cerr << "Usage: lox-cxx [filename]\n";
+    std::vector<std::string> filenames;
+    bool profile_ops = false;
+    bool profile_lines = false;
+    bool mem_stats = false;
+    bool write_perf_map = false;
+    bool time_phases = false;
+    bool watch = false;
+    const char* trace_file = nullptr;
+    const char* replay_file = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        const auto arg = std::string_view{argv[i]};
+        if (arg == "--profile-ops") {
+            profile_ops = true;
+        } else if (arg == "--profile-lines") {
+            profile_lines = true;
+        } else if (arg == "--mem-stats") {
+            mem_stats = true;
+        } else if (arg == "--time-phases") {
+            time_phases = true;
+        } else if (arg == "--perf-map") {
+            write_perf_map = true;
+        } else if (arg == "--watch") {
+            watch = true;
+        } else if (arg == "--trace" || arg == "--replay") {
+            if (i + 1 == argc) {
+                fmt::println(stderr, "{} requires a trace file", arg);
+                return 1;
+            }
+            (arg == "--trace" ? trace_file : replay_file) = argv[++i];
+        } else if (arg.starts_with("--")) {
+            fmt::println(stderr, "Unknown option '{}'", arg);
+            return 1;
+        } else {
+            filenames.emplace_back(arg);
+        }
+    }
+
+#if !defined(LOX_PROFILE_OPS)
+    if (profile_ops) {
+        fmt::println(stderr, "--profile-ops requires a build configured with -DLOX_PROFILE_OPS=ON");
+        return 1;
+    }
+#endif
+    if (watch && filenames.size() != 1) {
+        fmt::println(stderr, "--watch requires a single script");
+        return 1;
+    }
+#if !defined(LOX_ALLOCATION_STATS)
+    if (mem_stats) {
+        fmt::println(stderr, "--mem-stats requires a build configured with -DLOX_ALLOCATION_STATS=ON");
         return 1;
     }
+#endif
 
+    // Names the script in --profile-lines & --perf-map output
+    const auto script = filenames.size() == 1 ? filenames.front() : std::string{filenames.empty() ? "repl" : "bundle"};
     auto lox_engine = lox::Lox{};
-    if (argc == 2) {
-        lox_engine.run_file(argv[1]);
-    } else if (argc == 1) {
+    auto line_sampler = lox::LineSampler{};
+    if (profile_lines) {
+        lox_engine.set_line_sampler(&line_sampler);
+    }
+    if (mem_stats) {
+        lox_engine.enable_allocation_stats();
+    }
+#if defined(LOX_COUNT_ALLOCATIONS)
+    auto phase_timings = lox::PhaseTimings{&lox::thread_allocated_bytes};
+#else
+    auto phase_timings = lox::PhaseTimings{};
+#endif
+    if (time_phases) {
+        lox_engine.set_phase_timings(&phase_timings);
+    }
+    std::unique_ptr<lox::PerfMap> perf_map;
+    if (write_perf_map) {
+        auto created = lox::PerfMap::create();
+        if (!created) {
+            fmt::println(stderr, "{}", created.error());
+            return 1;
+        }
+        perf_map = std::move(*created);
+        lox_engine.set_perf_map(perf_map.get(), script);
+    }
+    std::unique_ptr<lox::TraceRecorder> recorder;
+    if (trace_file != nullptr) {
+        auto created = lox::TraceRecorder::create(trace_file);
+        if (!created) {
+            fmt::println(stderr, "{}", created.error());
+            return 1;
+        }
+        recorder = std::move(*created);
+        lox_engine.set_branch_observer(recorder.get());
+    }
+    std::optional<lox::TraceReplayer> replayer;
+    if (replay_file != nullptr) {
+        auto opened = lox::TraceReplayer::open(replay_file);
+        if (!opened) {
+            fmt::println(stderr, "{}", opened.error());
+            return 1;
+        }
+        replayer = std::move(*opened);
+        lox_engine.set_branch_observer(&*replayer);
+    }
+    if (watch) {
+        // Reruns the script whenever it's saved, only the statements that changed are compiled & linked again
+        lox_engine.set_incremental(true);
+        auto modified = std::filesystem::file_time_type{};
+        while (true) {
+            std::error_code error;
+            if (const auto time = std::filesystem::last_write_time(filenames.front(), error); !error && time != modified) {
+                modified = time;
+                lox_engine.run_file(filenames.front().c_str());
+                if (time_phases) {
+                    fmt::print(stderr, "{}", phase_timings.report());
+                    phase_timings.clear();
+                }
+                std::cout.flush();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{250});
+        }
+    }
+    if (filenames.size() > 1) {
+        lox_engine.run_bundle(filenames);
+    } else if (filenames.size() == 1) {
+        lox_engine.run_file(filenames.front().c_str());
+    } else {
         std::string input;
         do {
             std::cout << "> ";
@@ -23,5 +154,30 @@ int main(int argc, const char* argv[])
             lox_engine.run_string(input);
         } while (true);
     }
+
+#if defined(LOX_PROFILE_OPS)
+    if (profile_ops) {
+        fmt::print(stderr, "{}", lox_engine.op_profile().report());
+    }
+#endif
+    if (recorder) {
+        recorder->finish();
+        if (recorder->dropped() != 0) {
+            fmt::println(stderr, "trace: dropped {} of {} records", recorder->dropped(), recorder->dropped() + recorder->recorded());
+        }
+    }
+    if (replayer) {
+        fmt::println(stderr, "replay: verified {} branches{}", replayer->verified(), replayer->at_end() ? "" : ", the trace continues past the execution");
+    }
+    if (time_phases) {
+        fmt::print(stderr, "{}", phase_timings.report());
+    }
+    if (mem_stats) {
+        fmt::print(stderr, "{}", lox_engine.allocation_stats().report());
+    }
+    if (profile_lines) {
+        // Folded stacks for flamegraph.pl & compatible tools
+        fmt::print(stderr, "{}", line_sampler.folded(script));
+    }
     return 0;
 }
@@ -0,0 +1,120 @@
+#include "op_profiler.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <numeric>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    #include <x86intrin.h>
+    #define LOX_HAS_RDTSC 1
+#elif defined(_M_X64)
+    #include <intrin.h>
+    #define LOX_HAS_RDTSC 1
+#else
+    #include <chrono>
+#endif
+
+namespace lox
+{
+    namespace
+    {
+        double percentage(std::uint64_t part, std::uint64_t total)
+        {
+            return total == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(total);
+        }
+    } // namespace
+
+#if defined(LOX_HAS_RDTSC)
+    const char* const OpProfiler::time_unit = "cycles";
+#else
+    const char* const OpProfiler::time_unit = "ns";
+#endif
+
+    OpProfiler::OpProfiler()
+        : pairs_(std::make_unique<std::array<std::uint64_t, instruction_count * instruction_count>>())
+    {
+    }
+
+    std::uint64_t OpProfiler::now()
+    {
+#if defined(LOX_HAS_RDTSC)
+        return __rdtsc();
+#else
+        const auto since_epoch = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(since_epoch).count());
+#endif
+    }
+
+    void OpProfiler::begin(Instruction op)
+    {
+        const auto time = now();
+        if (running_) {
+            times_[index(current_)] += time - current_start_;
+            (*pairs_)[pair_index(current_, op)] += 1;
+        }
+        counts_[index(op)] += 1;
+        current_ = op;
+        current_start_ = time;
+        running_ = true;
+    }
+
+    void OpProfiler::end()
+    {
+        if (running_) {
+            times_[index(current_)] += now() - current_start_;
+            running_ = false;
+        }
+    }
+
+    void OpProfiler::clear()
+    {
+        counts_ = {};
+        times_ = {};
+        pairs_->fill(0);
+        running_ = false;
+    }
+
+    std::string OpProfiler::report(std::size_t max_pairs) const
+    {
+        std::vector<Instruction> instructions;
+        for (std::size_t i = 0; i < instruction_count; ++i) {
+            if (counts_[i] != 0) {
+                instructions.push_back(static_cast<Instruction>(i));
+            }
+        }
+        std::ranges::sort(instructions, std::greater{}, [this](Instruction op) { return time(op); });
+
+        const auto total_count = std::accumulate(counts_.begin(), counts_.end(), std::uint64_t{0});
+        const auto total_time = std::accumulate(times_.begin(), times_.end(), std::uint64_t{0});
+        auto report = fmt::format("{:<16}{:>14}{:>9}{:>16}{:>9}{:>12}\n", "instruction", "count", "%", time_unit, "%", "per op");
+        for (const auto op : instructions) {
+            report += fmt::format("{:<16}{:>14}{:>8.2f}%{:>16}{:>8.2f}%{:>12.1f}\n",
+                                  op, count(op), percentage(count(op), total_count),
+                                  time(op), percentage(time(op), total_time),
+                                  static_cast<double>(time(op)) / static_cast<double>(count(op)));
+        }
+
+        std::vector<std::tuple<std::uint64_t, Instruction, Instruction>> pairs;
+        std::uint64_t total_pairs = 0;
+        for (const auto first : instructions) {
+            for (const auto second : instructions) {
+                if (const auto frequency = pair_count(first, second); frequency != 0) {
+                    pairs.emplace_back(frequency, first, second);
+                    total_pairs += frequency;
+                }
+            }
+        }
+        const auto shown = std::min(max_pairs, pairs.size());
+        std::ranges::partial_sort(pairs, pairs.begin() + static_cast<std::ptrdiff_t>(shown), std::greater{});
+
+        report += fmt::format("\n{:<32}{:>14}{:>9}\n", "instruction pair", "count", "%");
+        for (const auto& [frequency, first, second] : std::span{pairs}.first(shown)) {
+            report += fmt::format("{:<32}{:>14}{:>8.2f}%\n", fmt::format("{} -> {}", first, second), frequency, percentage(frequency, total_pairs));
+        }
+        return report;
+    }
+} // namespace lox
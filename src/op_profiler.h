@@ -0,0 +1,68 @@
+#pragma once
+
+#include "vm_instruction.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace lox
+{
+    // Execution counts, time & opcode pair frequencies per Instruction. The VM only feeds it when built with
+    // LOX_PROFILE_OPS, see VM::op_profile(). Time is measured in TSC cycles on x86-64, nanoseconds elsewhere
+    class OpProfiler
+    {
+    public:
+        static const char* const time_unit;
+
+        // Closes the profiler's open interval, also when leaving VM::run() through an exception
+        class Session
+        {
+        public:
+            explicit Session(OpProfiler& profiler)
+                : profiler_(&profiler)
+            {
+            }
+            ~Session() { profiler_->end(); }
+
+            Session(const Session&) = delete;
+            Session& operator=(const Session&) = delete;
+
+        private:
+            OpProfiler* profiler_;
+        };
+
+        OpProfiler();
+
+        static std::uint64_t now();
+
+        // Charges the time since the previous begin() to the previous instruction and starts timing `op`
+        void begin(Instruction op);
+        // Charges the time since the last begin(), the next instruction won't form a pair with the last one
+        void end();
+        void clear();
+
+        [[nodiscard]] std::uint64_t count(Instruction op) const { return counts_[index(op)]; }
+        [[nodiscard]] std::uint64_t time(Instruction op) const { return times_[index(op)]; }
+        // How often `second` was executed directly after `first`
+        [[nodiscard]] std::uint64_t pair_count(Instruction first, Instruction second) const { return (*pairs_)[pair_index(first, second)]; }
+
+        // Instructions sorted by time followed by the most frequent pairs
+        [[nodiscard]] std::string report(std::size_t max_pairs = 20) const;
+
+    private:
+        static constexpr std::size_t instruction_count = 256;
+
+        static std::size_t index(Instruction op) { return static_cast<std::size_t>(op); }
+        static std::size_t pair_index(Instruction first, Instruction second) { return index(first) * instruction_count + index(second); }
+
+        std::array<std::uint64_t, instruction_count> counts_ = {};
+        std::array<std::uint64_t, instruction_count> times_ = {};
+        std::unique_ptr<std::array<std::uint64_t, instruction_count * instruction_count>> pairs_;
+        Instruction current_ = Instruction::Nop;
+        std::uint64_t current_start_ = 0;
+        bool running_ = false;
+    };
+} // namespace lox
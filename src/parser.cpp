@@ -2,36 +2,50 @@
 
 #include "error.h"
 
-#include <stdexcept>
-#include <string>
+#include <charconv>
+#include <system_error>
+
+// Evaluates a ParseNode expression and assigns its index to `target`, returning the error from the enclosing function
+#define LOX_TRY(target, expression)                      \
+    do {                                                 \
+        const auto lox_try_node = (expression);          \
+        if (!lox_try_node) [[unlikely]] {                \
+            return tl::unexpected(lox_try_node.error()); \
+        }                                                \
+        target = *lox_try_node;                          \
+    } while (false)
 
 namespace lox
 {
-    Parser::Parser(std::span<const Token> tokens)
-        : tokens_(tokens)
+    Parser::Parser(Lexer& lexer)
+        : lexer_(&lexer)
+        , tokens_(lexer)
+        , ast_(lexer.source())
     {
     }
 
     ParseResult Parser::parse()
     {
-        std::vector<StmtPtr> statements;
-        std::vector<LoxError> errors;
         while (!is_eof()) {
-            try {
-                statements.push_back(declaration());
-            } catch (const LoxError& err) {
-                errors.push_back(std::move(err));
+            if (const auto stmt = declaration()) {
+                ast_.add_root(*stmt);
+            } else {
+                // An error right where invalid input was skipped is caused by it & has already been reported
+                if (stmt.error().offset != invalid_input_end_) {
+                    errors_.emplace_back(stmt.error().message, lexer_->location_of(stmt.error().offset));
+                }
+                pending_nodes_.clear();
                 synchronize();
             }
         }
 
-        if (!errors.empty()) {
-            return tl::unexpected(std::move(errors));
+        if (!errors_.empty()) {
+            return tl::unexpected(std::move(errors_));
         }
-        return ParseResult{std::move(statements)};
+        return ParseResult{std::move(ast_)};
     }
 
-    StmtPtr Parser::declaration()
+    ParseNode Parser::declaration()
     {
         if (consume_expected(TokenType::Var)) {
             return var_decl();
@@ -42,59 +56,70 @@ namespace lox
         return statement();
     }
 
-    StmtPtr Parser::var_decl()
+    ParseNode Parser::var_decl()
     {
         auto identifier = consume_expected(TokenType::Identifier);
         if (!identifier) {
-            panic("expected variable name");
+            return error("expected variable name");
         }
 
-        ExprPtr initializer = nullptr;
+        NodeIndex initializer = null_node;
         if (consume_expected(TokenType::Equal)) {
-            initializer = expression();
+            LOX_TRY(initializer, expression());
         }
 
         if (!consume_expected(TokenType::Semicolon)) {
-            panic("expected ';' after variable declaration");
+            return error("expected ';' after variable declaration");
         }
-        return std::make_unique<VarDeclStmt>(*identifier, std::move(initializer));
+        return ast_.add_stmt({.kind = StmtKind::VarDecl, .offset = identifier->offset, .length = identifier->length, .first = initializer});
     }
 
-    StmtPtr Parser::fun_decl()
+    ParseNode Parser::fun_decl()
     {
         auto identifier = consume_expected(TokenType::Identifier);
         if (!identifier) {
-            panic("expected identifier");
+            return error("expected identifier");
         }
 
         if (!consume_expected(TokenType::LeftParen)) {
-            panic("expected '(' to start parameter list");
+            return error("expected '(' to start parameter list");
         }
 
         std::vector<Token> parameters;
         if (peek().type != TokenType::RightParen) {
             do {
                 if (parameters.size() >= 255) {
-                    panic("can't have more than 255 parameters");
+                    return error("can't have more than 255 parameters");
                 }
                 if (auto parameter = consume_expected(TokenType::Identifier)) {
                     parameters.push_back(*parameter);
                 } else {
-                    panic("expected parameter name");
+                    return error("expected parameter name");
                 }
             } while (consume_expected(TokenType::Comma));
         }
         if (!consume_expected(TokenType::RightParen)) {
-            panic("expected closing ')' after parameter list");
+            return error("expected closing ')' after parameter list");
         }
         if (!consume_expected(TokenType::LeftBrace)) {
-            panic("expected '{' before body");
+            return error("expected '{' before body");
         }
 
-        return std::make_unique<FunDeclStmt>(*identifier, std::move(parameters), block_stmt());
+        NodeIndex body;
+        LOX_TRY(body, block_stmt());
+        const auto params = ast_.add_params(parameters);
+        const auto count = static_cast<NodeIndex>(parameters.size());
+        return ast_.add_stmt({
+            .kind = StmtKind::FunDecl,
+            .offset = identifier->offset,
+            .length = identifier->length,
+            .first = params,
+            .second = count,
+            .third = body,
+        });
     }
 
-    StmtPtr Parser::statement()
+    ParseNode Parser::statement()
     {
         if (consume_expected(TokenType::If)) {
             return if_stmt();
@@ -117,287 +142,323 @@ namespace lox
         return expr_stmt();
     }
 
-    StmtPtr Parser::if_stmt()
+    ParseNode Parser::if_stmt()
     {
+        const auto keyword = last_token().offset;
         if (!consume_expected(TokenType::LeftParen)) {
-            panic("expected '(' after if");
+            return error("expected '(' after if");
         }
-        auto condition = expression();
+        NodeIndex condition;
+        LOX_TRY(condition, expression());
         if (!consume_expected(TokenType::RightParen)) {
-            panic("expected ')' after if condition");
+            return error("expected ')' after if condition");
         }
 
-        auto then_branch = statement();
-        StmtPtr else_branch = nullptr;
+        NodeIndex then_branch;
+        LOX_TRY(then_branch, statement());
+        NodeIndex else_branch = null_node;
         if (consume_expected(TokenType::Else)) {
-            else_branch = statement();
+            LOX_TRY(else_branch, statement());
         }
 
-        return std::make_unique<IfStmt>(std::move(condition), std::move(then_branch), std::move(else_branch));
+        return ast_.add_stmt({.kind = StmtKind::If, .offset = keyword, .first = condition, .second = then_branch, .third = else_branch});
     }
 
-    StmtPtr Parser::while_stmt()
+    ParseNode Parser::while_stmt()
     {
+        const auto keyword = last_token().offset;
         if (!consume_expected(TokenType::LeftParen)) {
-            panic("expected '(' after while");
+            return error("expected '(' after while");
         }
-        auto condition = expression();
+        NodeIndex condition;
+        LOX_TRY(condition, expression());
         if (!consume_expected(TokenType::RightParen)) {
-            panic("expected ')' after while condition");
+            return error("expected ')' after while condition");
         }
-        return std::make_unique<WhileStmt>(std::move(condition), statement());
+        NodeIndex body;
+        LOX_TRY(body, statement());
+        return ast_.add_stmt({.kind = StmtKind::While, .offset = keyword, .first = condition, .second = body});
     }
 
-    StmtPtr Parser::for_stmt()
+    ParseNode Parser::for_stmt()
     {
+        // The desugared nodes are attributed to the for keyword
+        const auto keyword = last_token().offset;
         if (!consume_expected(TokenType::LeftParen)) {
-            panic("expected '(' after for");
+            return error("expected '(' after for");
         }
 
-        StmtPtr initializer;
+        NodeIndex initializer = null_node;
         if (consume_expected(TokenType::Semicolon)) {
-            initializer = nullptr;
+            initializer = null_node;
         } else if (consume_expected(TokenType::Var)) {
-            initializer = var_decl();
+            LOX_TRY(initializer, var_decl());
         } else {
-            initializer = expr_stmt();
+            LOX_TRY(initializer, expr_stmt());
         }
 
-        ExprPtr condition = nullptr;
+        NodeIndex condition = null_node;
         if (peek().type != TokenType::Semicolon) {
-            condition = expression();
+            LOX_TRY(condition, expression());
         }
         if (!consume_expected(TokenType::Semicolon)) {
-            panic("expected ';' after loop condition");
+            return error("expected ';' after loop condition");
         }
 
-        ExprPtr increment = nullptr;
+        NodeIndex increment = null_node;
         if (peek().type != TokenType::Semicolon) {
-            increment = expression();
+            LOX_TRY(increment, expression());
         }
         if (!consume_expected(TokenType::RightParen)) {
-            panic("expected closing ')' after for loop");
+            return error("expected closing ')' after for loop");
         }
 
-        auto body = statement();
-        if (increment != nullptr) {
-            // Have to do this hack as you can't just do std::vector<StmtPtr>{std::move(body), ...}
-            // because std::initializer_list always copies the elements...
-            std::vector<StmtPtr> stmts;
-            stmts.reserve(2);
-            stmts.push_back(std::move(body));
-            stmts.push_back(std::make_unique<ExprStmt>(std::move(increment)));
-            body = std::make_unique<BlockStmt>(std::move(stmts));
+        NodeIndex body;
+        LOX_TRY(body, statement());
+        if (increment != null_node) {
+            const auto increment_stmt = ast_.add_stmt({.kind = StmtKind::Expr, .offset = keyword, .first = increment});
+            const NodeIndex stmts[] = {body, increment_stmt};
+            body = ast_.add_stmt({.kind = StmtKind::Block, .offset = keyword, .first = ast_.add_list(stmts)});
         }
 
-        if (condition == nullptr) {
-            condition = std::make_unique<LiteralExpr>(Token{}, true);
+        if (condition == null_node) {
+            condition = ast_.add_expr({.kind = ExprKind::Literal, .op = TokenType::True, .offset = keyword});
         }
-        body = std::make_unique<WhileStmt>(std::move(condition), std::move(body));
+        body = ast_.add_stmt({.kind = StmtKind::While, .offset = keyword, .first = condition, .second = body});
 
-        if (initializer != nullptr) {
-            // Again this hack is necessary.
-            // Probably should create a helper function to create BlockStmt or std::vector<StmtPtr> given n statements
-            std::vector<StmtPtr> stmts;
-            stmts.reserve(2);
-            stmts.push_back(std::move(initializer));
-            stmts.push_back(std::move(body));
-            body = std::make_unique<BlockStmt>(std::move(stmts));
+        if (initializer != null_node) {
+            const NodeIndex stmts[] = {initializer, body};
+            body = ast_.add_stmt({.kind = StmtKind::Block, .offset = keyword, .first = ast_.add_list(stmts)});
         }
 
         return body;
     }
 
-    StmtPtr Parser::return_stmt()
+    ParseNode Parser::return_stmt()
     {
-        ExprPtr value = nullptr;
+        NodeIndex value = null_node;
         if (peek().type != TokenType::Semicolon) {
-            value = expression();
+            LOX_TRY(value, expression());
         }
         if (auto ret = consume_expected(TokenType::Semicolon)) {
-            return std::make_unique<ReturnStmt>(*ret, std::move(value));
+            return ast_.add_stmt({.kind = StmtKind::Return, .offset = ret->offset, .first = value});
         }
-        panic("expected ';' after return statement");
+        return error("expected ';' after return statement");
     }
 
-    StmtPtr Parser::print_stmt()
+    ParseNode Parser::print_stmt()
     {
-        auto expr = expression();
+        const auto keyword = last_token().offset;
+        NodeIndex expr;
+        LOX_TRY(expr, expression());
         if (!consume_expected(TokenType::Semicolon)) {
-            panic("expected ';' after expression");
+            return error("expected ';' after expression");
         }
-        return std::make_unique<PrintStmt>(std::move(expr));
+        return ast_.add_stmt({.kind = StmtKind::Print, .offset = keyword, .first = expr});
     }
 
-    std::unique_ptr<BlockStmt> Parser::block_stmt()
+    ParseNode Parser::block_stmt()
     {
-        std::vector<StmtPtr> statements;
+        const auto brace = last_token().offset;
+        const auto pending_start = pending_nodes_.size();
         while (peek().type != TokenType::RightBrace && !is_eof()) {
-            statements.push_back(declaration());
+            NodeIndex statement;
+            LOX_TRY(statement, declaration());
+            pending_nodes_.push_back(statement);
         }
         if (!consume_expected(TokenType::RightBrace)) {
-            panic("expected closing '}' after block");
+            return error("expected closing '}' after block");
         }
-        return std::make_unique<BlockStmt>(std::move(statements));
+        const auto statements = ast_.add_list(std::span{pending_nodes_}.subspan(pending_start));
+        pending_nodes_.resize(pending_start);
+        return ast_.add_stmt({.kind = StmtKind::Block, .offset = brace, .first = statements});
     }
 
-    StmtPtr Parser::expr_stmt()
+    ParseNode Parser::expr_stmt()
     {
-        auto expr = expression();
+        const auto start = peek().offset;
+        NodeIndex expr;
+        LOX_TRY(expr, expression());
         if (!consume_expected(TokenType::Semicolon)) {
-            panic("expected ';' after expression");
+            return error("expected ';' after expression");
         }
-        return std::make_unique<ExprStmt>(std::move(expr));
+        return ast_.add_stmt({.kind = StmtKind::Expr, .offset = start, .first = expr});
     }
 
-    ExprPtr Parser::expression()
+    ParseNode Parser::expression()
     {
         return assignment();
     }
 
-    ExprPtr Parser::assignment()
+    ParseNode Parser::assignment()
     {
-        auto expr = logical_or();
+        NodeIndex expr;
+        LOX_TRY(expr, logical_or());
         if (consume_expected(TokenType::Equal)) {
-            auto value = assignment();
-            if (const auto* var_expr = dynamic_cast<const VarExpr*>(expr.get())) {
-                auto name = var_expr->identifier();
-                return std::make_unique<AssignmentExpr>(name, std::move(value));
+            NodeIndex value;
+            LOX_TRY(value, assignment());
+            if (const auto& target = ast_.expr(expr); target.kind == ExprKind::Var) {
+                return ast_.add_expr({.kind = ExprKind::Assignment, .offset = target.offset, .first = value, .second = target.first});
             }
-            panic("invalid assignment target");
+            return error("invalid assignment target");
         }
         return expr;
     }
 
-    ExprPtr Parser::logical_or()
+    ParseNode Parser::logical_or()
     {
-        auto expr = logical_and();
+        NodeIndex expr;
+        LOX_TRY(expr, logical_and());
         while (consume_expected(TokenType::Or)) {
-            auto op = last_token();
-            expr = std::make_unique<LogicExpr>(std::move(expr), op, logical_and());
+            const auto op = last_token();
+            NodeIndex rhs;
+            LOX_TRY(rhs, logical_and());
+            expr = ast_.add_expr({.kind = ExprKind::Logic, .op = op.type, .offset = op.offset, .first = expr, .second = rhs});
         }
         return expr;
     }
 
-    ExprPtr Parser::logical_and()
+    ParseNode Parser::logical_and()
     {
-        auto expr = equality();
+        NodeIndex expr;
+        LOX_TRY(expr, equality());
         while (consume_expected(TokenType::And)) {
-            auto op = last_token();
-            expr = std::make_unique<LogicExpr>(std::move(expr), op, equality());
+            const auto op = last_token();
+            NodeIndex rhs;
+            LOX_TRY(rhs, equality());
+            expr = ast_.add_expr({.kind = ExprKind::Logic, .op = op.type, .offset = op.offset, .first = expr, .second = rhs});
         }
         return expr;
     }
 
-    ExprPtr Parser::equality()
+    ParseNode Parser::equality()
     {
-        auto expr = comparison();
+        NodeIndex expr;
+        LOX_TRY(expr, comparison());
         while (consume_expected({{TokenType::BangEqual, TokenType::EqualEqual}})) {
-            auto op = last_token();
-            expr = std::make_unique<BinaryExpr>(std::move(expr), op, comparison());
+            const auto op = last_token();
+            NodeIndex rhs;
+            LOX_TRY(rhs, comparison());
+            expr = ast_.add_expr({.kind = ExprKind::Binary, .op = op.type, .offset = op.offset, .first = expr, .second = rhs});
         }
         return expr;
     }
 
-    ExprPtr Parser::comparison()
+    ParseNode Parser::comparison()
     {
-        auto expr = additive();
+        NodeIndex expr;
+        LOX_TRY(expr, additive());
         while (consume_expected({{TokenType::Greater, TokenType::GreaterEqual, TokenType::Less, TokenType::LessEqual}})) {
-            auto op = last_token();
-            expr = std::make_unique<BinaryExpr>(std::move(expr), op, additive());
+            const auto op = last_token();
+            NodeIndex rhs;
+            LOX_TRY(rhs, additive());
+            expr = ast_.add_expr({.kind = ExprKind::Binary, .op = op.type, .offset = op.offset, .first = expr, .second = rhs});
         }
         return expr;
     }
 
-    ExprPtr Parser::additive()
+    ParseNode Parser::additive()
     {
-        auto expr = multiplicative();
+        NodeIndex expr;
+        LOX_TRY(expr, multiplicative());
         while (consume_expected({{TokenType::Plus, TokenType::Minus}})) {
-            auto op = last_token();
-            expr = std::make_unique<BinaryExpr>(std::move(expr), op, multiplicative());
+            const auto op = last_token();
+            NodeIndex rhs;
+            LOX_TRY(rhs, multiplicative());
+            expr = ast_.add_expr({.kind = ExprKind::Binary, .op = op.type, .offset = op.offset, .first = expr, .second = rhs});
         }
         return expr;
     }
 
-    ExprPtr Parser::multiplicative()
+    ParseNode Parser::multiplicative()
     {
-        auto expr = unary();
+        NodeIndex expr;
+        LOX_TRY(expr, unary());
         while (consume_expected({{TokenType::Star, TokenType::Slash}})) {
-            auto op = last_token();
-            expr = std::make_unique<BinaryExpr>(std::move(expr), op, unary());
+            const auto op = last_token();
+            NodeIndex rhs;
+            LOX_TRY(rhs, unary());
+            expr = ast_.add_expr({.kind = ExprKind::Binary, .op = op.type, .offset = op.offset, .first = expr, .second = rhs});
         }
         return expr;
     }
 
-    ExprPtr Parser::unary()
+    ParseNode Parser::unary()
     {
         if (consume_expected({{TokenType::Bang, TokenType::Minus}})) {
-            auto op = last_token();
-            return std::make_unique<UnaryExpr>(op, unary());
+            const auto op = last_token();
+            NodeIndex operand;
+            LOX_TRY(operand, unary());
+            return ast_.add_expr({.kind = ExprKind::Unary, .op = op.type, .offset = op.offset, .first = operand});
         }
         return call();
     }
 
-    ExprPtr Parser::call()
+    ParseNode Parser::call()
     {
-        auto expr = primary();
+        NodeIndex expr;
+        LOX_TRY(expr, primary());
         while (consume_expected(TokenType::LeftParen)) {
-            std::vector<ExprPtr> arguments;
+            const auto pending_start = pending_nodes_.size();
             if (peek().type != TokenType::RightParen) {
                 do {
-                    if (arguments.size() >= 255) {
-                        panic("can't have more than 255 arguments");
+                    if (pending_nodes_.size() - pending_start >= 255) {
+                        return error("can't have more than 255 arguments");
                     }
-                    arguments.push_back(expression());
+                    NodeIndex argument;
+                    LOX_TRY(argument, expression());
+                    pending_nodes_.push_back(argument);
                 } while (consume_expected(TokenType::Comma));
             }
             if (auto call_end = consume_expected(TokenType::RightParen)) {
-                return std::make_unique<CallExpr>(std::move(expr), std::move(arguments), *call_end);
+                const auto arguments = ast_.add_list(std::span{pending_nodes_}.subspan(pending_start));
+                pending_nodes_.resize(pending_start);
+                return ast_.add_expr({.kind = ExprKind::Call, .offset = call_end->offset, .first = expr, .second = arguments});
             }
-            panic("expected closing ')' after arguments");
+            return error("expected closing ')' after arguments");
         }
         return expr;
     }
 
-    ExprPtr Parser::primary()
+    ParseNode Parser::primary()
     {
         if (consume_expected(TokenType::Number)) {
-            try {
-                auto number = last_token();
-                double value = std::stod(std::string{number.lexeme});
-                return std::make_unique<LiteralExpr>(number, value);
-            } catch (const std::invalid_argument& e) {
-                panic("could not convert number literal to a number");
-            } catch (const std::out_of_range& e) {
-                panic("number literal value is out of range");
+            const auto number = last_token();
+            double value = 0;
+            const auto lexeme = lexer_->lexeme(number);
+            const auto [end, ec] = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+            if (ec == std::errc::result_out_of_range) {
+                return error("number literal value is out of range");
+            }
+            if (ec != std::errc{}) {
+                return error("could not convert number literal to a number");
             }
+            return ast_.add_expr({.kind = ExprKind::Literal, .op = TokenType::Number, .offset = number.offset, .first = ast_.add_number(value)});
         }
         if (consume_expected(TokenType::String)) {
             auto string = last_token();
-            return std::make_unique<LiteralExpr>(string, std::string{string.lexeme.substr(1, string.lexeme.length() - 2)});
+            return ast_.add_expr({.kind = ExprKind::Literal, .op = TokenType::String, .offset = string.offset, .first = string.length});
         }
-        if (consume_expected({{TokenType::True, TokenType::False}})) {
-            auto boolean = last_token();
-            return std::make_unique<LiteralExpr>(boolean, boolean.type == TokenType::True);
-        }
-        if (consume_expected(TokenType::Nil)) {
-            auto nil = last_token();
-            return std::make_unique<LiteralExpr>(nil, NilLiteral{});
+        if (consume_expected({{TokenType::True, TokenType::False, TokenType::Nil}})) {
+            const auto literal = last_token();
+            return ast_.add_expr({.kind = ExprKind::Literal, .op = literal.type, .offset = literal.offset});
         }
         if (consume_expected(TokenType::LeftParen)) {
-            auto expr = expression();
+            const auto paren = last_token().offset;
+            NodeIndex expr;
+            LOX_TRY(expr, expression());
             if (!consume_expected(TokenType::RightParen)) {
-                panic("missing closing )");
+                return error("missing closing )");
             }
-            return std::make_unique<ParenExpr>(std::move(expr));
+            return ast_.add_expr({.kind = ExprKind::Paren, .offset = paren, .first = expr});
         }
         if (auto identifier = consume_expected(TokenType::Identifier)) {
-            return std::make_unique<VarExpr>(*identifier);
+            return ast_.add_expr({.kind = ExprKind::Var, .offset = identifier->offset, .first = identifier->length});
         }
-        panic("expected expression");
+        return error("expected expression");
     }
 
-    bool Parser::is_eof() const
+    bool Parser::is_eof()
     {
         return peek().type == TokenType::Eof;
     }
@@ -407,12 +468,18 @@ namespace lox
         if (is_eof()) {
             return last_token();
         }
-        return tokens_[current_token_++];
+        return tokens_.consume();
     }
 
-    Token Parser::peek() const
+    Token Parser::peek()
     {
-        return tokens_[current_token_];
+        // Invalid input is reported & skipped so parsing carries on as if it wasn't there
+        while (tokens_.peek().type == TokenType::Error) [[unlikely]] {
+            const auto invalid = tokens_.consume();
+            invalid_input_end_ = Lexer::error_offset(invalid);
+            errors_.emplace_back(lexer_->error_message(invalid), lexer_->location_of(invalid_input_end_));
+        }
+        return tokens_.peek();
     }
 
     tl::expected<Token, Token> Parser::consume_expected(TokenType expected)
@@ -435,12 +502,12 @@ namespace lox
 
     Token Parser::last_token() const
     {
-        return tokens_[current_token_ - 1];
+        return tokens_.last();
     }
 
-    void Parser::panic(const char* msg) const
+    tl::unexpected<ParseError> Parser::error(const char* msg)
     {
-        throw LoxError(msg, peek().location);
+        return tl::unexpected(ParseError{msg, peek().offset});
     }
 
     void Parser::synchronize()
@@ -1,62 +1,80 @@
 #pragma once
 
-#include "ast.h"
 #include "error.h"
+#include "flat_ast.h"
+#include "lexer.h"
 #include "token.h"
+#include "token_stream.h"
 
 #include <tl/expected.hpp>
 
+#include <cstdint>
 #include <span>
 #include <vector>
 
 namespace lox
 {
-    using ParseResult = tl::expected<std::vector<StmtPtr>, std::vector<LoxError>>;
+    using ParseResult = tl::expected<FlatAst, std::vector<LoxError>>;
+
+    // Syntax error returned up to Parser::parse(), which turns it into a LoxError and resynchronizes. Errors are
+    // propagated as values since broken input is common (e.g. linting) and unwinding would dominate parse time
+    struct ParseError {
+        const char* message;
+        std::uint32_t offset;
+    };
+
+    using ParseNode = tl::expected<NodeIndex, ParseError>;
 
     class Parser
     {
     public:
-        explicit Parser(std::span<const Token> tokens);
+        // Tokens are pulled from the lexer while parsing, lexer errors are reported as parse errors
+        explicit Parser(Lexer& lexer);
 
         ParseResult parse();
 
     private:
-        StmtPtr declaration();
-        StmtPtr var_decl();
-        StmtPtr fun_decl();
-        StmtPtr statement();
-        StmtPtr if_stmt();
-        StmtPtr while_stmt();
-        StmtPtr for_stmt();
-        StmtPtr return_stmt();
-        StmtPtr print_stmt();
-        std::unique_ptr<BlockStmt> block_stmt();
-        StmtPtr expr_stmt();
-        ExprPtr expression();
-        ExprPtr assignment();
-        ExprPtr logical_or();
-        ExprPtr logical_and();
-        ExprPtr equality();
-        ExprPtr comparison();
-        ExprPtr additive();
-        ExprPtr multiplicative();
-        ExprPtr unary();
-        ExprPtr call();
-        ExprPtr primary();
-
-        [[nodiscard]] bool is_eof() const;
+        ParseNode declaration();
+        ParseNode var_decl();
+        ParseNode fun_decl();
+        ParseNode statement();
+        ParseNode if_stmt();
+        ParseNode while_stmt();
+        ParseNode for_stmt();
+        ParseNode return_stmt();
+        ParseNode print_stmt();
+        ParseNode block_stmt();
+        ParseNode expr_stmt();
+        ParseNode expression();
+        ParseNode assignment();
+        ParseNode logical_or();
+        ParseNode logical_and();
+        ParseNode equality();
+        ParseNode comparison();
+        ParseNode additive();
+        ParseNode multiplicative();
+        ParseNode unary();
+        ParseNode call();
+        ParseNode primary();
+
+        [[nodiscard]] bool is_eof();
 
         Token consume();
-        Token peek() const;
+        Token peek();
         tl::expected<Token, Token> consume_expected(TokenType expected);
         tl::expected<Token, Token> consume_expected(std::span<const TokenType> expected);
 
         Token last_token() const;
 
-        [[noreturn]] void panic(const char* msg) const;
+        [[nodiscard]] tl::unexpected<ParseError> error(const char* msg);
         void synchronize();
 
-        std::span<const Token> tokens_;
-        std::size_t current_token_ = 0;
+        Lexer* lexer_;
+        TokenStream tokens_;
+        FlatAst ast_;
+        std::vector<LoxError> errors_;
+        std::uint32_t invalid_input_end_ = UINT32_MAX;
+        // Children of the blocks and calls being parsed, nested lists are stacked on top of each other
+        std::vector<NodeIndex> pending_nodes_;
     };
 } // namespace lox
@@ -0,0 +1,106 @@
+#include "perf_map.h"
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define LOX_HAS_PERF_MAP 1
+#endif
+
+namespace lox
+{
+    namespace
+    {
+#if defined(__x86_64__)
+        // push %rbp; mov %rsp, %rbp; call *%rsi; pop %rbp; ret
+        constexpr std::uint8_t trampoline_code[] = {0x55, 0x48, 0x89, 0xe5, 0xff, 0xd6, 0x5d, 0xc3};
+#elif defined(__aarch64__)
+        // stp x29, x30, [sp, #-16]!; mov x29, sp; blr x1; ldp x29, x30, [sp], #16; ret
+        constexpr std::uint32_t trampoline_code[] = {0xa9bf7bfd, 0x910003fd, 0xd63f0020, 0xa8c17bfd, 0xd65f03c0};
+#endif
+#if defined(LOX_HAS_PERF_MAP)
+        // Keeps every trampoline at its own aligned address
+        constexpr std::size_t trampoline_size = 32;
+        static_assert(sizeof(trampoline_code) <= trampoline_size);
+#endif
+    } // namespace
+
+    tl::expected<std::unique_ptr<PerfMap>, std::string> PerfMap::create()
+    {
+#if defined(LOX_HAS_PERF_MAP)
+        auto map = std::unique_ptr<PerfMap>{new PerfMap{}};
+        map->filename_ = fmt::format("/tmp/perf-{}.map", ::getpid());
+        // Appended to, perf reads whatever the process wrote over its lifetime
+        map->file_ = std::fopen(map->filename_.c_str(), "a");
+        if (map->file_ == nullptr) {
+            return tl::unexpected(fmt::format("{}: {}", map->filename_, std::strerror(errno)));
+        }
+        return map;
+#else
+        return tl::unexpected(std::string{"perf map: only supported on Linux for x86-64 & AArch64"});
+#endif
+    }
+
+    PerfMap::~PerfMap()
+    {
+#if defined(LOX_HAS_PERF_MAP)
+        const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        for (auto* page : pages_) {
+            ::munmap(page, page_size);
+        }
+#endif
+        if (file_ != nullptr) {
+            std::fclose(file_);
+        }
+    }
+
+    void PerfMap::enter(std::string_view symbol, Entry entry, void* context)
+    {
+        auto trampoline = trampolines_.find(symbol);
+        if (trampoline == trampolines_.end()) {
+            trampoline = trampolines_.emplace(symbol, make_trampoline(symbol)).first;
+        }
+        if (trampoline->second == nullptr) {
+            entry(context);
+            return;
+        }
+        trampoline->second(context, entry);
+    }
+
+    PerfMap::Trampoline PerfMap::make_trampoline([[maybe_unused]] std::string_view symbol)
+    {
+#if defined(LOX_HAS_PERF_MAP)
+        const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        if (pages_.empty() || page_used_ + trampoline_size > page_size) {
+            auto* page = ::mmap(nullptr, page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (page == MAP_FAILED) {
+                // The symbol runs without a frame of its own
+                return nullptr;
+            }
+            pages_.push_back(page);
+            page_used_ = 0;
+        } else if (::mprotect(pages_.back(), page_size, PROT_READ | PROT_WRITE) != 0) {
+            return nullptr;
+        }
+
+        auto* code = static_cast<char*>(pages_.back()) + page_used_;
+        std::memcpy(code, trampoline_code, sizeof(trampoline_code));
+        page_used_ += trampoline_size;
+        if (::mprotect(pages_.back(), page_size, PROT_READ | PROT_EXEC) != 0) {
+            return nullptr;
+        }
+        __builtin___clear_cache(code, code + sizeof(trampoline_code));
+
+        fmt::print(file_, "{:x} {:x} {}\n", reinterpret_cast<std::uintptr_t>(code), sizeof(trampoline_code), symbol);
+        std::fflush(file_);
+        return reinterpret_cast<Trampoline>(code);
+#else
+        return nullptr;
+#endif
+    }
+} // namespace lox
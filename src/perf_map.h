@@ -0,0 +1,70 @@
+#pragma once
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <exception>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lox
+{
+    // Makes Lox scripts visible to `perf record -g`. Every script runs below a small trampoline of its own, a copy of
+    // the same few instructions in executable memory, and /tmp/perf-<pid>.map names each copy, so perf report
+    // attributes the VM frames above it to the script. Frames are found through the frame pointer, the trampoline
+    // keeps the chain intact. Supported on Linux for x86-64 & AArch64
+    class PerfMap
+    {
+    public:
+        // Error is a message in the form "<filename>: <reason>"
+        static tl::expected<std::unique_ptr<PerfMap>, std::string> create();
+
+        ~PerfMap();
+
+        PerfMap(const PerfMap&) = delete;
+        PerfMap& operator=(const PerfMap&) = delete;
+
+        // Calls `function` below the trampoline for `symbol`, exceptions are passed on to the caller
+        template<typename Function>
+        void run(std::string_view symbol, Function&& function)
+        {
+            std::exception_ptr error;
+            auto call = [&]() noexcept {
+                try {
+                    function();
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            };
+            // Nothing may unwind through the trampoline, it has no unwind info
+            enter(symbol, [](void* context) noexcept { (*static_cast<decltype(call)*>(context))(); }, &call);
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+        [[nodiscard]] const std::string& filename() const { return filename_; }
+        [[nodiscard]] std::size_t symbols() const { return trampolines_.size(); }
+
+    private:
+        using Entry = void (*)(void*) noexcept;
+        using Trampoline = void (*)(void* context, Entry entry) noexcept;
+
+        PerfMap() = default;
+
+        void enter(std::string_view symbol, Entry entry, void* context);
+        // Copies the trampoline code for a new symbol & adds it to the map file
+        Trampoline make_trampoline(std::string_view symbol);
+
+        std::string filename_;
+        std::FILE* file_ = nullptr;
+        std::map<std::string, Trampoline, std::less<>> trampolines_;
+        // Executable pages, each filled with trampolines before the next one is mapped
+        std::vector<void*> pages_;
+        std::size_t page_used_ = 0;
+    };
+} // namespace lox
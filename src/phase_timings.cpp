@@ -0,0 +1,77 @@
+#include "phase_timings.h"
+
+#include <fmt/format.h>
+
+namespace lox
+{
+    const char* format_as(Phase phase)
+    {
+        switch (phase) {
+            case Phase::Lex:
+                return "lex";
+            case Phase::Parse:
+                return "parse";
+            case Phase::Compile:
+                return "compile";
+            case Phase::Execute:
+                return "execute";
+        }
+        return "unknown";
+    }
+
+    PhaseTimings::Scope::Scope(PhaseTimings* timings, Phase phase)
+        : timings_(timings)
+        , phase_(phase)
+    {
+        if (timings_ != nullptr) {
+            allocated_at_start_ = timings_->allocated_bytes();
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    PhaseTimings::Scope::~Scope()
+    {
+        if (timings_ == nullptr) {
+            return;
+        }
+        auto& timing = timings_->phases_[static_cast<std::size_t>(phase_)];
+        timing.duration += std::chrono::steady_clock::now() - start_;
+        timing.allocated_bytes += timings_->allocated_bytes() - allocated_at_start_;
+    }
+
+    std::uint64_t PhaseTimings::allocated_bytes() const
+    {
+        return allocation_counter_ != nullptr ? allocation_counter_() : 0;
+    }
+
+    std::chrono::nanoseconds PhaseTimings::total_duration() const
+    {
+        auto total = std::chrono::nanoseconds{};
+        for (const auto& phase : phases_) {
+            total += phase.duration;
+        }
+        return total;
+    }
+
+    std::string PhaseTimings::report() const
+    {
+        static constexpr const char* item_names[phase_count] = {"tokens", "nodes", "instructions", "checkpoints"};
+
+        const auto total = total_duration();
+        auto report = fmt::format("{:<10}{:>12}{:>8}{:>14}{:<14}{:>16}\n", "phase", "time (us)", "%", "items", "", "allocated");
+        for (std::size_t i = 0; i < phase_count; ++i) {
+            const auto& phase = phases_[i];
+            const auto micros = std::chrono::duration<double, std::micro>{phase.duration}.count();
+            const auto share = total.count() != 0 ? 100.0 * static_cast<double>(phase.duration.count()) / static_cast<double>(total.count()) : 0.0;
+            const auto items = phase.items != 0 ? fmt::format("{:>14} {:<13}", phase.items, item_names[i]) : fmt::format("{:>14}{:<14}", "-", "");
+            const auto allocated = allocation_counter_ != nullptr ? fmt::format("{:>16}", phase.allocated_bytes) : fmt::format("{:>16}", "-");
+            report += fmt::format("{:<10}{:>12.1f}{:>8.1f}{}{}\n", static_cast<Phase>(i), micros, share, items, allocated);
+        }
+        report += fmt::format("{:<10}{:>12.1f}\n", "total", std::chrono::duration<double, std::micro>{total}.count());
+        // The lex row is an extra pass, see Lox::run_string()
+        if (phases_[static_cast<std::size_t>(Phase::Lex)].duration.count() != 0) {
+            report += "parse includes lexing, the parser pulls its tokens from the lexer as it goes\n";
+        }
+        return report;
+    }
+} // namespace lox
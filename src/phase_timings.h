@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace lox
+{
+    enum class Phase : std::uint8_t {
+        Lex,
+        Parse,
+        Compile,
+        Execute,
+    };
+
+    inline constexpr std::size_t phase_count = 4;
+
+    const char* format_as(Phase phase);
+
+    struct PhaseTiming {
+        std::chrono::nanoseconds duration{};
+        // Tokens, AST nodes, compiled instructions & budget checkpoints passed (backward jumps & calls) respectively.
+        // Executed instructions aren't counted, that would need the VM's instrumented dispatch loop
+        std::uint64_t items = 0;
+        // Requested through operator new on the measuring thread, zero without an allocation counter
+        std::uint64_t allocated_bytes = 0;
+    };
+
+    // Returns the bytes requested through operator new on the calling thread so far, see allocation_counter.h
+    using AllocationCounter = std::uint64_t (*)();
+
+    // Time, work & allocations per phase, accumulated over every run measured since the last clear()
+    class PhaseTimings
+    {
+    public:
+        // Allocations are only measured with a counter, the report shows "-" for them otherwise
+        explicit PhaseTimings(AllocationCounter allocation_counter = nullptr)
+            : allocation_counter_(allocation_counter)
+        {
+        }
+
+        // Adds the time & allocations while in scope to the phase, a null timings pointer is ignored
+        class Scope
+        {
+        public:
+            Scope(PhaseTimings* timings, Phase phase);
+            ~Scope();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            PhaseTimings* timings_;
+            Phase phase_;
+            std::chrono::steady_clock::time_point start_;
+            std::uint64_t allocated_at_start_ = 0;
+        };
+
+        void add_items(Phase phase, std::uint64_t items) { phases_[static_cast<std::size_t>(phase)].items += items; }
+        void clear() { phases_ = {}; }
+
+        [[nodiscard]] const PhaseTiming& operator[](Phase phase) const { return phases_[static_cast<std::size_t>(phase)]; }
+        [[nodiscard]] std::chrono::nanoseconds total_duration() const;
+
+        // One line per phase with its share of the total time
+        [[nodiscard]] std::string report() const;
+
+    private:
+        [[nodiscard]] std::uint64_t allocated_bytes() const;
+
+        AllocationCounter allocation_counter_;
+        std::array<PhaseTiming, phase_count> phases_ = {};
+    };
+} // namespace lox
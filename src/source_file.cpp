@@ -0,0 +1,143 @@
+#include "source_file.h"
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define LOX_HAS_MMAP 1
+#endif
+
+namespace lox
+{
+    namespace
+    {
+        constexpr std::size_t read_chunk_size = 64 * 1024;
+
+        std::string open_error(const char* filename)
+        {
+            return fmt::format("{}: {}", filename, std::strerror(errno));
+        }
+
+#if defined(LOX_HAS_MMAP)
+        // Closes the descriptor once the file has been mapped or read, the mapping stays valid after close
+        struct FileDescriptor {
+            int fd;
+            ~FileDescriptor() { ::close(fd); }
+        };
+#endif
+    } // namespace
+
+    tl::expected<SourceFile, std::string> SourceFile::open(const char* filename)
+    {
+        auto source = SourceFile{};
+#if defined(LOX_HAS_MMAP)
+        const int fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            return tl::unexpected(open_error(filename));
+        }
+        const auto file = FileDescriptor{fd};
+
+        struct stat info = {};
+        if (::fstat(fd, &info) == -1) {
+            return tl::unexpected(open_error(filename));
+        }
+        if (S_ISREG(info.st_mode) && info.st_size > 0) {
+            const auto size = static_cast<std::size_t>(info.st_size);
+            void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                ::madvise(mapping, size, MADV_SEQUENTIAL);
+                source.mapping_ = static_cast<const char*>(mapping);
+                source.mapping_size_ = size;
+                return source;
+            }
+            // Fall back to reading, e.g. for file systems that don't support mapping
+        }
+
+        while (true) {
+            const auto size = source.buffer_.size();
+            source.buffer_.resize(size + read_chunk_size);
+            const auto count = ::read(fd, source.buffer_.data() + size, read_chunk_size);
+            if (count == -1 && errno == EINTR) {
+                source.buffer_.resize(size);
+                continue;
+            }
+            if (count == -1) {
+                return tl::unexpected(open_error(filename));
+            }
+            source.buffer_.resize(size + static_cast<std::size_t>(count));
+            if (count == 0) {
+                break;
+            }
+        }
+#else
+        const auto file = std::unique_ptr<std::FILE, int (*)(std::FILE*)>{std::fopen(filename, "rb"), &std::fclose};
+        if (file == nullptr) {
+            return tl::unexpected(open_error(filename));
+        }
+        while (true) {
+            const auto size = source.buffer_.size();
+            source.buffer_.resize(size + read_chunk_size);
+            const auto count = std::fread(source.buffer_.data() + size, sizeof(char), read_chunk_size, file.get());
+            source.buffer_.resize(size + count);
+            if (count < read_chunk_size) {
+                if (std::ferror(file.get())) {
+                    return tl::unexpected(open_error(filename));
+                }
+                break;
+            }
+        }
+#endif
+        return source;
+    }
+
+    SourceFile::~SourceFile()
+    {
+        unmap();
+    }
+
+    SourceFile::SourceFile(SourceFile&& other) noexcept
+        : mapping_(std::exchange(other.mapping_, nullptr))
+        , mapping_size_(std::exchange(other.mapping_size_, 0))
+        , buffer_(std::move(other.buffer_))
+    {
+    }
+
+    SourceFile& SourceFile::operator=(SourceFile&& other) noexcept
+    {
+        if (this != &other) {
+            unmap();
+            mapping_ = std::exchange(other.mapping_, nullptr);
+            mapping_size_ = std::exchange(other.mapping_size_, 0);
+            buffer_ = std::move(other.buffer_);
+        }
+        return *this;
+    }
+
+    std::string_view SourceFile::text() const
+    {
+        if (mapping_ != nullptr) {
+            return {mapping_, mapping_size_};
+        }
+        return buffer_;
+    }
+
+    void SourceFile::unmap()
+    {
+#if defined(LOX_HAS_MMAP)
+        if (mapping_ != nullptr) {
+            ::munmap(const_cast<char*>(mapping_), mapping_size_);
+        }
+#endif
+        mapping_ = nullptr;
+        mapping_size_ = 0;
+    }
+} // namespace lox
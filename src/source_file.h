@@ -0,0 +1,37 @@
+#pragma once
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace lox
+{
+    // Read-only source text of a script. Regular files are memory mapped so the Lexer reads straight from the
+    // mapping without copying, pipes & character devices (e.g. /dev/stdin) fall back to a buffered read
+    class SourceFile
+    {
+    public:
+        // Error is a message in the form "<filename>: <reason>"
+        static tl::expected<SourceFile, std::string> open(const char* filename);
+
+        ~SourceFile();
+
+        SourceFile(const SourceFile&) = delete;
+        SourceFile(SourceFile&& other) noexcept;
+        SourceFile& operator=(const SourceFile&) = delete;
+        SourceFile& operator=(SourceFile&& other) noexcept;
+
+        [[nodiscard]] std::string_view text() const;
+
+    private:
+        SourceFile() = default;
+
+        void unmap();
+
+        const char* mapping_ = nullptr;
+        std::size_t mapping_size_ = 0;
+        std::string buffer_;
+    };
+} // namespace lox
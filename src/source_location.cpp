@@ -1 +1,35 @@
 #include "source_location.h"
+
+#include "lexer_scan.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace lox
+{
+    LineIndex::LineIndex(std::string_view source)
+        : source_(source)
+    {
+    }
+
+    SourceLocation LineIndex::locate(std::uint32_t offset) const
+    {
+        assert(offset <= source_.size());
+        if (line_starts_.empty()) {
+            build();
+        }
+        const auto line = std::ranges::upper_bound(line_starts_, offset) - 1;
+        return {
+            .line = static_cast<std::int32_t>(line - line_starts_.begin() + 1),
+            .column = static_cast<std::int32_t>(offset - *line + 1),
+        };
+    }
+
+    void LineIndex::build() const
+    {
+        line_starts_.push_back(0);
+        for (auto newline = scan::find_char(source_, 0, '\n'); newline < source_.size(); newline = scan::find_char(source_, newline + 1, '\n')) {
+            line_starts_.push_back(static_cast<std::uint32_t>(newline + 1));
+        }
+    }
+} // namespace lox
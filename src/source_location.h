@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <string_view>
+#include <vector>
 
 namespace lox
 {
@@ -16,4 +18,20 @@ namespace lox
 
         constexpr bool operator==(const SourceLocation&) const = default;
     };
+
+    // Maps source offsets to line & column. The table of line starts is only built the first time a location
+    // is requested, i.e. when an error is reported or debug info is needed
+    class LineIndex
+    {
+    public:
+        explicit LineIndex(std::string_view source);
+
+        [[nodiscard]] SourceLocation locate(std::uint32_t offset) const;
+
+    private:
+        void build() const;
+
+        std::string_view source_;
+        mutable std::vector<std::uint32_t> line_starts_;
+    };
 } // namespace lox
@@ -81,6 +81,8 @@ namespace lox
                 return "Print";
             case TokenType::Return:
                 return "Return";
+            case TokenType::Error:
+                return "Error";
         }
     }
 } // namespace lox
@@ -1,13 +1,12 @@
 #pragma once
 
-#include "source_location.h"
-
+#include <cstdint>
 #include <string_view>
 
 namespace lox
 {
-    enum class TokenType {
-        Eof = -1,
+    enum class TokenType : std::uint8_t {
+        Eof,
 
         Plus,
         Minus,
@@ -54,13 +53,22 @@ namespace lox
 
         Print,
         Return,
+
+        // Invalid input, see Lexer::scan_token()
+        Error,
     };
 
+    // The lexeme isn't stored, tokens refer back into the source by offset & length
     struct Token {
         TokenType type;
-        std::string_view lexeme;
-        SourceLocation location;
+        // Offset of the lexeme in the source, see Lexer::location_of()
+        std::uint32_t offset;
+        std::uint32_t length;
+
+        [[nodiscard]] std::string_view lexeme(std::string_view source) const { return source.substr(offset, length); }
     };
 
+    static_assert(sizeof(Token) == 12);
+
     const char* format_as(TokenType type);
 } // namespace lox
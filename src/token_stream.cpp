@@ -0,0 +1,36 @@
+#include "token_stream.h"
+
+#include "lexer.h"
+
+#include <cassert>
+
+namespace lox
+{
+    TokenStream::TokenStream(Lexer& lexer)
+        : lexer_(&lexer)
+    {
+    }
+
+    const Token& TokenStream::peek(std::size_t distance)
+    {
+        assert(distance <= max_lookahead);
+        while (buffered_ <= distance) {
+            ring_[(head_ + buffered_) & (capacity - 1)] = lexer_->scan_token();
+            buffered_ += 1;
+        }
+        return ring_[(head_ + distance) & (capacity - 1)];
+    }
+
+    Token TokenStream::consume()
+    {
+        const auto token = peek();
+        head_ = (head_ + 1) & (capacity - 1);
+        buffered_ -= 1;
+        return token;
+    }
+
+    const Token& TokenStream::last() const
+    {
+        return ring_[(head_ - 1) & (capacity - 1)];
+    }
+} // namespace lox
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "token.h"
+
+#include <array>
+#include <cstddef>
+
+namespace lox
+{
+    class Lexer;
+
+    // Pulls tokens from a Lexer on demand, keeping only the previously consumed token and a small
+    // lookahead window in a ring buffer instead of materializing the whole token list. Invalid input is passed on
+    // as TokenType::Error tokens
+    class TokenStream
+    {
+    public:
+        static constexpr std::size_t max_lookahead = 2;
+
+        explicit TokenStream(Lexer& lexer);
+
+        // Token `distance` tokens ahead of the current one, lexing it if it hasn't been yet
+        const Token& peek(std::size_t distance = 0);
+        Token consume();
+        // The most recently consumed token
+        [[nodiscard]] const Token& last() const;
+
+    private:
+        static constexpr std::size_t capacity = 4;
+        static_assert((capacity & (capacity - 1)) == 0, "ring buffer capacity must be a power of 2");
+        static_assert(max_lookahead + 2 <= capacity, "ring buffer must hold the last token & the lookahead window");
+
+        Lexer* lexer_;
+        std::array<Token, capacity> ring_ = {};
+        std::size_t head_ = 0;
+        std::size_t buffered_ = 0;
+    };
+} // namespace lox
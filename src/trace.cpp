@@ -0,0 +1,230 @@
+#include "trace.h"
+
+#include "error.h"
+#include "source_file.h"
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define LOX_HAS_MMAP 1
+#endif
+
+namespace lox
+{
+    namespace
+    {
+        constexpr std::size_t header_size = sizeof(trace::magic) + sizeof(std::uint32_t);
+
+        std::uint32_t read_u32(std::string_view bytes, std::size_t offset)
+        {
+            std::uint32_t value;
+            std::memcpy(&value, bytes.data() + offset, sizeof(value));
+            return value;
+        }
+
+        std::string create_error(const char* filename)
+        {
+            return fmt::format("{}: {}", filename, std::strerror(errno));
+        }
+    } // namespace
+
+    std::uint32_t trace::hash(std::span<const std::uint8_t> bytecode)
+    {
+        // FNV-1a, only used to tell programs apart
+        std::uint32_t hash = 2166136261u;
+        for (const auto byte : bytecode) {
+            hash = (hash ^ byte) * 16777619u;
+        }
+        // Keep the marker unambiguous
+        return hash == trace::program_marker ? 0 : hash;
+    }
+
+    tl::expected<std::unique_ptr<TraceRecorder>, std::string> TraceRecorder::create(const char* filename)
+    {
+        char header[header_size];
+        std::memcpy(header, trace::magic, sizeof(trace::magic));
+        std::memcpy(header + sizeof(trace::magic), &trace::version, sizeof(trace::version));
+
+        auto recorder = std::unique_ptr<TraceRecorder>{new TraceRecorder{}};
+#if defined(LOX_HAS_MMAP)
+        recorder->fd_ = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (recorder->fd_ == -1 || ::write(recorder->fd_, header, header_size) != static_cast<ssize_t>(header_size)) {
+            return tl::unexpected(create_error(filename));
+        }
+        recorder->file_size_ = header_size;
+#else
+        recorder->file_ = std::fopen(filename, "wb");
+        if (recorder->file_ == nullptr || std::fwrite(header, header_size, 1, recorder->file_) != 1) {
+            return tl::unexpected(create_error(filename));
+        }
+        recorder->buffer_.resize(segment_records + 1);
+#endif
+        return recorder;
+    }
+
+    TraceRecorder::~TraceRecorder()
+    {
+        finish();
+    }
+
+    void TraceRecorder::on_program(std::span<const std::uint8_t> bytecode)
+    {
+        record(trace::program_marker);
+        record(trace::hash(bytecode));
+    }
+
+#if defined(LOX_HAS_MMAP)
+    void TraceRecorder::next_segment()
+    {
+        close_segment();
+        if (fd_ == -1) {
+            return;
+        }
+        // Segments follow each other directly, the mapping starts at the page containing the segment
+        constexpr auto segment_size = (segment_records + 1) * sizeof(std::uint32_t);
+        const auto page_size = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+        const auto mapping_offset = file_size_ / page_size * page_size;
+        if (::ftruncate(fd_, static_cast<off_t>(file_size_ + segment_size)) != 0) {
+            return;
+        }
+        mapping_size_ = file_size_ + segment_size - mapping_offset;
+        mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(mapping_offset));
+        if (mapping_ == MAP_FAILED) {
+            mapping_ = nullptr;
+            return;
+        }
+        auto* segment = reinterpret_cast<std::uint32_t*>(static_cast<char*>(mapping_) + (file_size_ - mapping_offset));
+        segment[0] = 0;
+        records_ = segment + 1;
+        capacity_ = segment_records;
+    }
+
+    void TraceRecorder::close_segment()
+    {
+        if (mapping_ == nullptr) {
+            return;
+        }
+        records_[-1] = static_cast<std::uint32_t>(used_);
+        // Doesn't wait for the dirty pages to be written back
+        ::munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+        file_size_ += (used_ + 1) * sizeof(std::uint32_t);
+        recorded_ += used_;
+        records_ = nullptr;
+        used_ = 0;
+        capacity_ = 0;
+    }
+
+    void TraceRecorder::finish()
+    {
+        close_segment();
+        if (fd_ != -1) {
+            // Drop the unused tail of the last segment
+            [[maybe_unused]] const auto result = ::ftruncate(fd_, static_cast<off_t>(file_size_));
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+#else
+    void TraceRecorder::next_segment()
+    {
+        close_segment();
+        if (file_ != nullptr) {
+            records_ = buffer_.data() + 1;
+            capacity_ = segment_records;
+        }
+    }
+
+    void TraceRecorder::close_segment()
+    {
+        if (records_ == nullptr) {
+            return;
+        }
+        buffer_[0] = static_cast<std::uint32_t>(used_);
+        std::fwrite(buffer_.data(), sizeof(std::uint32_t), used_ + 1, file_);
+        recorded_ += used_;
+        records_ = nullptr;
+        used_ = 0;
+        capacity_ = 0;
+    }
+
+    void TraceRecorder::finish()
+    {
+        close_segment();
+        if (file_ != nullptr) {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+#endif
+
+    tl::expected<TraceReplayer, std::string> TraceReplayer::open(const char* filename)
+    {
+        const auto file = SourceFile::open(filename);
+        if (!file) {
+            return tl::unexpected(file.error());
+        }
+        const auto bytes = file->text();
+        if (bytes.size() < header_size || std::memcmp(bytes.data(), trace::magic, sizeof(trace::magic)) != 0) {
+            return tl::unexpected(fmt::format("{}: not a trace file", filename));
+        }
+        if (read_u32(bytes, sizeof(trace::magic)) != trace::version) {
+            return tl::unexpected(fmt::format("{}: unsupported trace version", filename));
+        }
+
+        auto replayer = TraceReplayer{};
+        for (auto offset = header_size; offset < bytes.size();) {
+            if (bytes.size() - offset < sizeof(std::uint32_t)) {
+                return tl::unexpected(fmt::format("{}: truncated trace", filename));
+            }
+            const auto count = read_u32(bytes, offset);
+            offset += sizeof(std::uint32_t);
+            if ((bytes.size() - offset) / sizeof(std::uint32_t) < count) {
+                return tl::unexpected(fmt::format("{}: truncated trace", filename));
+            }
+            for (std::uint32_t i = 0; i < count; ++i, offset += sizeof(std::uint32_t)) {
+                replayer.records_.push_back(read_u32(bytes, offset));
+            }
+        }
+        return replayer;
+    }
+
+    void TraceReplayer::on_program(std::span<const std::uint8_t> bytecode)
+    {
+        if (next() != trace::program_marker) {
+            throw LoxError("replay diverged: program started where the trace has a branch", {});
+        }
+        if (next() != trace::hash(bytecode)) {
+            throw LoxError("replay diverged: program differs from the traced one", {});
+        }
+    }
+
+    void TraceReplayer::on_branch(std::uint32_t offset, bool taken)
+    {
+        const auto record = next();
+        if (record == trace::program_marker) {
+            throw LoxError(fmt::format("replay diverged: branch at {} where the trace starts a program", offset), {});
+        }
+        if (record >> 1 != offset || static_cast<bool>(record & 1) != taken) {
+            throw LoxError(fmt::format("replay diverged: branch at {} {} where the trace has the branch at {} {}", offset,
+                                       taken ? "taken" : "not taken", record >> 1, (record & 1) != 0 ? "taken" : "not taken"),
+                           {});
+        }
+        ++verified_;
+    }
+
+    std::uint32_t TraceReplayer::next()
+    {
+        if (at_end()) {
+            throw LoxError("replay diverged: the trace ended before the execution", {});
+        }
+        return records_[next_++];
+    }
+} // namespace lox
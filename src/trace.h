@@ -0,0 +1,125 @@
+#pragma once
+
+#include <tl/expected.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace lox
+{
+    // Sees every program the VM starts & the outcome of every conditional branch it executes, see
+    // VM::set_branch_observer(). Offsets are code offsets of the branch instruction, like LineTable's
+    class BranchObserver
+    {
+    public:
+        virtual ~BranchObserver() = default;
+
+        virtual void on_program(std::span<const std::uint8_t> bytecode) = 0;
+        virtual void on_branch(std::uint32_t offset, bool taken) = 0;
+    };
+
+    // Trace file layout, integers in host byte order:
+    //   header:   "LOXTRACE" & u32 version
+    //   segments: u32 record count followed by the records, the count is written once the segment is complete
+    //   record:   u32 (offset << 1 | taken), or program_marker followed by a u32 hash of the program's bytecode
+    namespace trace
+    {
+        inline constexpr char magic[8] = {'L', 'O', 'X', 'T', 'R', 'A', 'C', 'E'};
+        inline constexpr std::uint32_t version = 1;
+        inline constexpr std::uint32_t program_marker = UINT32_MAX;
+
+        std::uint32_t hash(std::span<const std::uint8_t> bytecode);
+    } // namespace trace
+
+    // Appends records straight into a memory mapped segment of the trace file, the kernel writes full segments back
+    // in the background so the interpreter never waits on the disk. Without mmap segments are buffered & written
+    // with stdio. Like LineSampler it doesn't start a thread, see there why
+    class TraceRecorder final : public BranchObserver
+    {
+    public:
+        static constexpr std::size_t segment_records = 256 * 1024 - 1;
+
+        // Error is a message in the form "<filename>: <reason>"
+        static tl::expected<std::unique_ptr<TraceRecorder>, std::string> create(const char* filename);
+
+        // Calls finish()
+        ~TraceRecorder() override;
+
+        TraceRecorder(const TraceRecorder&) = delete;
+        TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+        void on_program(std::span<const std::uint8_t> bytecode) override;
+        void on_branch(std::uint32_t offset, bool taken) override { record(offset << 1 | static_cast<std::uint32_t>(taken)); }
+
+        // Completes the last segment & closes the file, nothing is recorded afterwards
+        void finish();
+
+        [[nodiscard]] std::uint64_t recorded() const { return recorded_ + used_; }
+        // Records lost because the file couldn't be extended
+        [[nodiscard]] std::uint64_t dropped() const { return dropped_; }
+
+    private:
+        TraceRecorder() = default;
+
+        void record(std::uint32_t record)
+        {
+            if (used_ == capacity_) [[unlikely]] {
+                next_segment();
+                if (used_ == capacity_) {
+                    ++dropped_;
+                    return;
+                }
+            }
+            records_[used_++] = record;
+        }
+        // Completes the current segment & starts the next one, leaves no capacity if that fails
+        void next_segment();
+        void close_segment();
+
+        std::uint32_t* records_ = nullptr;
+        std::size_t used_ = 0;
+        std::size_t capacity_ = 0;
+        std::uint64_t recorded_ = 0;
+        std::uint64_t dropped_ = 0;
+
+#if defined(__unix__) || defined(__APPLE__)
+        int fd_ = -1;
+        std::uint64_t file_size_ = 0;
+        void* mapping_ = nullptr;
+        std::size_t mapping_size_ = 0;
+#else
+        std::FILE* file_ = nullptr;
+        std::vector<std::uint32_t> buffer_;
+#endif
+    };
+
+    // Checks a re-execution against a recorded trace, throwing a LoxError at the first branch that went another way
+    class TraceReplayer final : public BranchObserver
+    {
+    public:
+        // Error is a message in the form "<filename>: <reason>"
+        static tl::expected<TraceReplayer, std::string> open(const char* filename);
+
+        void on_program(std::span<const std::uint8_t> bytecode) override;
+        void on_branch(std::uint32_t offset, bool taken) override;
+
+        [[nodiscard]] std::uint64_t verified() const { return verified_; }
+        // True if every record of the trace was replayed
+        [[nodiscard]] bool at_end() const { return next_ == records_.size(); }
+
+    private:
+        TraceReplayer() = default;
+
+        // Throws if the trace is exhausted
+        std::uint32_t next();
+
+        std::vector<std::uint32_t> records_;
+        std::size_t next_ = 0;
+        std::uint64_t verified_ = 0;
+    };
+} // namespace lox
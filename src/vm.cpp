@@ -1,7 +1,9 @@
 #include "vm.h"
 
 #include "bytecode.h"
+#include "bytecode_compiler.h"
 #include "error.h"
+#include "execution_task.h"
 #include "vm_instruction.h"
 
 #include "lox_boolean.h"
@@ -14,169 +16,362 @@
 #include <cassert>
 #include <cstdio>
 #include <cstring>
+#include <utility>
 
 #define LOX_BINARY_OP(lhs, rhs, op, op_string)                        \
     auto result = lhs->op(rhs.get());                                 \
     if (!result) {                                                    \
         throw_unsupported_binary_op(op_string, lhs.get(), rhs.get()); \
     }                                                                 \
-    push(std::move(result))
+    push_unchecked(std::move(result))
 
 #define LOX_UNARY_OP(object, op, op_string)                  \
     auto result = object->op();                              \
     if (!result) {                                           \
         throw_unsupported_unary_op(op_string, object.get()); \
     }                                                        \
-    push(std::move(result))
+    push_unchecked(std::move(result))
 
 #define LOX_COMPARE(lhs, rhs, comparison, comp_string)    \
     if (const auto result = lhs->comparison(rhs.get())) { \
-        push(LoxBoolean::get_ref(*result));               \
+        push_unchecked(LoxBoolean::get_ref(*result));     \
         return;                                           \
     }                                                     \
     throw_unsupported_binary_op(comp_string, lhs.get(), rhs.get())
 
 namespace lox
 {
-    void VM::execute(std::span<const std::uint8_t> code)
+    VM::VM()
+        : VM(default_stack_size)
+    {
+    }
+
+    VM::VM(std::size_t stack_size)
+        : stack_(std::make_unique<LoxObjectRef[]>(stack_size))
+        , stack_top_(stack_.get())
+        , stack_end_(stack_.get() + stack_size)
+    {
+    }
+
+    ExecutionStatus VM::execute(const CompileOutput& program, std::uint64_t budget)
+    {
+        if (program.max_stack_depth > stack_size()) {
+            throw_stack_overflow(program.max_stack_depth);
+        }
+        // Locals are addressed from the stack base, drop anything left over from an aborted execution
+        unwind_stack();
+        program_ = &program;
+        if (branch_observer_ != nullptr) {
+            branch_observer_->on_program(program.bytecode);
+        }
+        bytecode_ = Bytecode{program.bytecode};
+        if (allocation_stats_ != nullptr) {
+            const auto accounting = AllocationStats::Scope{allocation_stats_.get()};
+            allocation_stats_->set_instruction(std::nullopt);
+            load_constants();
+        } else {
+            load_constants();
+        }
+        code_start_ = bytecode_.position();
+        return run(budget);
+    }
+
+    ExecutionStatus VM::resume(std::uint64_t budget)
+    {
+        assert(is_suspended() && "no suspended execution to resume");
+        return run(budget);
+    }
+
+    ExecutionTask VM::execute_async(const CompileOutput& program, std::uint64_t slice_budget)
+    {
+        auto status = execute(program, slice_budget);
+        while (status != ExecutionStatus::Completed) {
+            co_yield status;
+            status = resume(slice_budget);
+        }
+    }
+
+    void VM::load_constants()
     {
-        auto bytecode = Bytecode{code};
-        // Extract constants
         constants_.clear();
-        while (bytecode.peek() == '@') {
-            bytecode.read(); // consume @
-            const auto index = bytecode.read();
-            const auto type = bytecode.read();
+        while (!bytecode_.is_eof() && bytecode_.peek() == '@') {
+            bytecode_.read(); // consume @
+            const auto index = bytecode_.read();
+            const auto type = bytecode_.read();
             switch (type) {
                 case 'd':
-                    constants_.push_back(std::make_shared<LoxNumber>(bytecode.read_number()));
+                    constants_.push_back(make_shared_object<LoxNumber>(bytecode_.read_number()));
                     break;
                 case 's':
-                    constants_.push_back(std::make_shared<LoxString>(bytecode.read_string()));
+                    constants_.push_back(make_shared_object<LoxString>(bytecode_.read_string()));
                     break;
             }
         }
+    }
 
-        while (!bytecode.is_eof()) {
-            const auto op = bytecode.fetch();
-            switch (op) {
-                case Instruction::Nop:
-                    continue;
-                case Instruction::Add:
-                    op_add();
-                    continue;
-                case Instruction::Sub:
-                    op_sub();
-                    continue;
-                case Instruction::Mul:
-                    op_mul();
-                    continue;
-                case Instruction::Div:
-                    op_div();
-                    continue;
-                case Instruction::Neg:
-                    op_neg();
-                    continue;
-                case Instruction::Not:
-                    op_not();
-                    continue;
-                case Instruction::Less:
-                    op_less();
-                    continue;
-                case Instruction::Greater:
-                    op_greater();
-                    continue;
-                case Instruction::Equal:
-                    op_equal();
-                    continue;
-                case Instruction::PushConstant:
-                    op_push_constant(bytecode.read());
-                    continue;
-                case Instruction::PushNil:
-                    op_push_nil();
-                    continue;
-                case Instruction::PushTrue:
-                    op_push_true();
-                    continue;
-                case Instruction::PushFalse:
-                    op_push_false();
-                    continue;
-                case Instruction::Pop:
-                    op_pop();
-                    continue;
-                case Instruction::Print:
-                    op_print();
-                    continue;
-                case Instruction::DefineGlobal:
-                    op_define_global(bytecode.read());
-                    continue;
-                case Instruction::SetGlobal:
-                    op_set_global(bytecode.read());
-                    continue;
-                case Instruction::GetGlobal:
-                    op_get_global(bytecode.read());
-                    continue;
-                case Instruction::SetLocal:
-                    op_set_local(bytecode.read());
-                    continue;
-                case Instruction::GetLocal:
-                    op_get_local(bytecode.read());
-                    continue;
-                case Instruction::Jmp:
-                    bytecode.jump(bytecode.read_word());
-                    continue;
-                case Instruction::JmpFalse:
-                    if (const auto offset = bytecode.read_word(); !peek()->is_truthy()) {
-                        bytecode.jump(offset);
+    ExecutionStatus VM::run(std::uint64_t budget)
+    {
+        if (line_sampler_ == nullptr && allocation_stats_ == nullptr) {
+            return branch_observer_ == nullptr ? dispatch<Instrumentation::None>(budget) : dispatch<Instrumentation::Branches>(budget);
+        }
+        const auto accounting = AllocationStats::Scope{allocation_stats_.get()};
+        return dispatch<Instrumentation::Full>(budget);
+    }
+
+    template <VM::Instrumentation Level>
+    ExecutionStatus VM::dispatch(std::uint64_t budget)
+    {
+        assert(budget > 0 && "execution budget must be positive");
+        // Work on a local copy of the instruction pointer, it is only written back when suspending so an
+        // execution aborted by an error is not resumable
+        auto bytecode = std::exchange(bytecode_, Bytecode{{}});
+        const auto initial_budget = budget;
+#if defined(LOX_PROFILE_OPS)
+        const auto profile_session = OpProfiler::Session{op_profiler_};
+#endif
+        try {
+            while (!bytecode.is_eof()) {
+                if constexpr (Level == Instrumentation::Full) {
+                    if (line_sampler_ != nullptr && line_sampler_->sample_due()) [[unlikely]] {
+                        line_sampler_->record(program_->lines.line_at(bytecode.position() - code_start_));
                     }
-                    continue;
-                case Instruction::JmpTrue:
-                    if (const auto offset = bytecode.read_word(); peek()->is_truthy()) {
-                        bytecode.jump(offset);
+                }
+                const auto op = bytecode.fetch();
+                if constexpr (Level == Instrumentation::Full) {
+                    ++instructions_executed_;
+                    if (allocation_stats_ != nullptr) {
+                        allocation_stats_->set_instruction(op);
                     }
-                    continue;
-                case Instruction::JmpSigned:
-                    bytecode.jump_signed(bytecode.read_signed_word());
-                    continue;
-                case Instruction::Trap:
-                    throw VMTrap();
+                }
+#if defined(LOX_PROFILE_OPS)
+                op_profiler_.begin(op);
+#endif
+                switch (op) {
+                    case Instruction::Nop:
+                        continue;
+                    case Instruction::Add:
+                        op_add();
+                        continue;
+                    case Instruction::Sub:
+                        op_sub();
+                        continue;
+                    case Instruction::Mul:
+                        op_mul();
+                        continue;
+                    case Instruction::Div:
+                        op_div();
+                        continue;
+                    case Instruction::Neg:
+                        op_neg();
+                        continue;
+                    case Instruction::Not:
+                        op_not();
+                        continue;
+                    case Instruction::Less:
+                        op_less();
+                        continue;
+                    case Instruction::Greater:
+                        op_greater();
+                        continue;
+                    case Instruction::Equal:
+                        op_equal();
+                        continue;
+                    case Instruction::PushConstant:
+                        op_push_constant(bytecode.read());
+                        continue;
+                    case Instruction::PushNil:
+                        op_push_nil();
+                        continue;
+                    case Instruction::PushTrue:
+                        op_push_true();
+                        continue;
+                    case Instruction::PushFalse:
+                        op_push_false();
+                        continue;
+                    case Instruction::Pop:
+                        op_pop();
+                        continue;
+                    case Instruction::Print:
+                        op_print();
+                        continue;
+                    case Instruction::DefineGlobal:
+                        op_define_global(bytecode.read());
+                        continue;
+                    case Instruction::SetGlobal:
+                        op_set_global(bytecode.read());
+                        continue;
+                    case Instruction::GetGlobal:
+                        op_get_global(bytecode.read());
+                        continue;
+                    case Instruction::SetLocal:
+                        op_set_local(bytecode.read());
+                        continue;
+                    case Instruction::GetLocal:
+                        op_get_local(bytecode.read());
+                        continue;
+                    case Instruction::Jmp:
+                        bytecode.jump(bytecode.read_word());
+                        continue;
+                    case Instruction::JmpFalse:
+                        if (const auto offset = bytecode.read_word(); !peek()->is_truthy()) {
+                            if constexpr (Level != Instrumentation::None) {
+                                observe_branch(bytecode, true);
+                            }
+                            bytecode.jump(offset);
+                        } else if constexpr (Level != Instrumentation::None) {
+                            observe_branch(bytecode, false);
+                        }
+                        continue;
+                    case Instruction::JmpTrue:
+                        if (const auto offset = bytecode.read_word(); peek()->is_truthy()) {
+                            if constexpr (Level != Instrumentation::None) {
+                                observe_branch(bytecode, true);
+                            }
+                            bytecode.jump(offset);
+                        } else if constexpr (Level != Instrumentation::None) {
+                            observe_branch(bytecode, false);
+                        }
+                        continue;
+                    case Instruction::JmpSigned:
+                        bytecode.jump_signed(bytecode.read_signed_word());
+                        if (--budget == 0 || suspend_requested_.load(std::memory_order_relaxed)) [[unlikely]] {
+                            bytecode_ = bytecode;
+                            checkpoints_passed_ += initial_budget - budget;
+                            return suspend_requested_.exchange(false) ? ExecutionStatus::Suspended : ExecutionStatus::BudgetExhausted;
+                        }
+                        continue;
+                    case Instruction::Call:
+                    case Instruction::Trap:
+                        throw VMTrap();
+                }
+                assert(false && "unhandled/invalid bytecode in VM::execute()");
             }
-            assert(false && "unhandled/invalid bytecode in VM::execute()");
+        } catch (LoxError& error) {
+            checkpoints_passed_ += initial_budget - budget;
+            suspend_requested_.store(false, std::memory_order_relaxed);
+            // Errors are located only once raised, the failing instruction has been read up to its last byte
+            if (!error.has_location()) {
+                locate(error, bytecode.position() - 1);
+            }
+            throw;
+        }
+        checkpoints_passed_ += initial_budget - budget;
+        // A request that came after the last checkpoint must not suspend the next execution
+        suspend_requested_.store(false, std::memory_order_relaxed);
+        return ExecutionStatus::Completed;
+    }
+
+    void VM::locate(LoxError& error, std::size_t position) const
+    {
+        const auto run = program_->lines.run_at(position - code_start_);
+        // The line table has no columns
+        error.set_location({.line = static_cast<std::int32_t>(run.line), .column = 0});
+        if (run.file < program_->files.size()) {
+            error.set_file(program_->files[run.file]);
+        }
+    }
+
+    void VM::observe_branch(const Bytecode& bytecode, bool taken)
+    {
+        if (branch_observer_ != nullptr) {
+            // Called with the jump operand read, the branch starts 3 bytes earlier
+            const auto offset = bytecode.position() - 3 - code_start_;
+            branch_observer_->on_branch(static_cast<std::uint32_t>(offset), taken);
+        }
+    }
+
+    void VM::enable_allocation_stats()
+    {
+        if (allocation_stats_ == nullptr) {
+            allocation_stats_ = std::make_unique<AllocationStats>();
+        }
+    }
+
+    const AllocationStats& VM::stats() const
+    {
+        static const auto disabled = AllocationStats{};
+        return allocation_stats_ != nullptr ? *allocation_stats_ : disabled;
+    }
+
+    void VM::define_native(std::string name, LoxObjectRef value)
+    {
+        globals_[name] = value;
+        natives_[std::move(name)] = std::move(value);
+    }
+
+    void VM::reset()
+    {
+        unwind_stack();
+        bytecode_ = Bytecode{{}};
+        suspend_requested_ = false;
+        constants_.clear();
+        std::erase_if(globals_, [this](const auto& global) { return !natives_.contains(global.first); });
+        // Scripts may have reassigned a native, restore the host provided value
+        for (const auto& [name, value] : natives_) {
+            globals_[name] = value;
         }
     }
 
     void VM::push(LoxObjectRef object)
     {
-        stack_.push_back(std::move(object));
+        // Hosts & natives aren't part of the depth the compiler computed
+        if (stack_top_ == stack_end_) [[unlikely]] {
+            throw_stack_overflow(stack_size() + 1);
+        }
+        push_unchecked(std::move(object));
+    }
+
+    void VM::push_unchecked(LoxObjectRef object)
+    {
+        assert(stack_top_ != stack_end_ && "stack depth exceeds the compiler computed maximum");
+        *stack_top_++ = std::move(object);
     }
 
     LoxObjectRef VM::pop()
     {
-        assert(!stack_.empty());
-        auto value = std::move(stack_.back());
-        stack_.pop_back();
-        return value;
+        assert(stack_top_ != stack_.get());
+        return std::move(*--stack_top_);
     }
 
     LoxObjectRef VM::peek() const
     {
-        assert(!stack_.empty());
-        return stack_.back();
+        assert(stack_top_ != stack_.get());
+        return stack_top_[-1];
+    }
+
+    void VM::unwind_stack()
+    {
+        while (stack_top_ != stack_.get()) {
+            (--stack_top_)->reset();
+        }
+    }
+
+    void VM::note_string_copy(const std::string& string)
+    {
+        // Short names fit the small string buffer & don't allocate
+        if (allocation_stats_ != nullptr && string.size() > std::string{}.capacity()) [[unlikely]] {
+            allocation_stats_->record_string_copy(string.capacity() + 1);
+        }
     }
 
     void VM::throw_unsupported_binary_op(const char* op, const LoxObject* lhs, const LoxObject* rhs) const
     {
-        throw LoxError(fmt::format("unsupported binary operation {} with types '{}' & '{}'", op, lhs->type_name(), rhs->type_name()), current_location());
+        throw LoxError(fmt::format("unsupported binary operation {} with types '{}' & '{}'", op, lhs->type_name(), rhs->type_name()), {});
     }
 
     void VM::throw_unsupported_unary_op(const char* op, const LoxObject* object) const
     {
-        throw LoxError(fmt::format("unsupported unary operation {} with type '{}'", op, object->type_name()), current_location());
+        throw LoxError(fmt::format("unsupported unary operation {} with type '{}'", op, object->type_name()), {});
     }
 
     void VM::throw_undefined_global(const std::string& identifier) const
     {
-        throw LoxError(fmt::format("accessing undefined global '{}'", identifier), current_location());
+        throw LoxError(fmt::format("accessing undefined global '{}'", identifier), {});
+    }
+
+    void VM::throw_stack_overflow(std::size_t required) const
+    {
+        throw LoxError(fmt::format("stack overflow: program requires {} stack slots, stack size is {}", required, stack_size()), {});
     }
 
     void VM::op_add()
@@ -209,13 +404,14 @@ namespace lox
 
     void VM::op_neg()
     {
-        LOX_UNARY_OP(pop(), negate, "negate '-'");
+        auto object = pop();
+        LOX_UNARY_OP(object, negate, "negate '-'");
     }
 
     void VM::op_not()
     {
         auto object = pop();
-        push(std::make_shared<LoxBoolean>(!object->is_truthy()));
+        push_unchecked(LoxBoolean::get_ref(!object->is_truthy()));
     }
 
     void VM::op_less()
@@ -241,22 +437,22 @@ namespace lox
 
     void VM::op_push_constant(std::uint8_t index)
     {
-        push(constants_[index]);
+        push_unchecked(constants_[index]);
     }
 
     void VM::op_push_nil()
     {
-        push(LoxNil::nil_ref());
+        push_unchecked(LoxNil::nil_ref());
     }
 
     void VM::op_push_true()
     {
-        push(LoxBoolean::true_ref());
+        push_unchecked(LoxBoolean::true_ref());
     }
 
     void VM::op_push_false()
     {
-        push(LoxBoolean::false_ref());
+        push_unchecked(LoxBoolean::false_ref());
     }
 
     void VM::op_pop()
@@ -266,18 +462,25 @@ namespace lox
 
     void VM::op_print()
     {
-        std::puts(pop()->to_string().c_str());
+        const auto text = pop()->to_string();
+        if (output_ != nullptr) {
+            output_->append(text).push_back('\n');
+            return;
+        }
+        std::puts(text.c_str());
     }
 
     void VM::op_define_global(std::uint8_t index)
     {
-        const auto identifier = constants_[index];
-        globals_[identifier->to_string()] = pop();
+        auto identifier = constants_[index]->to_string();
+        note_string_copy(identifier);
+        globals_[std::move(identifier)] = pop();
     }
 
     void VM::op_set_global(std::uint8_t index)
     {
         const auto identifier = constants_[index]->to_string();
+        note_string_copy(identifier);
         if (auto iter = globals_.find(identifier); iter != globals_.end()) {
             iter->second = peek();
         } else {
@@ -288,8 +491,9 @@ namespace lox
     void VM::op_get_global(std::uint8_t index)
     {
         const auto identifier = constants_[index]->to_string();
+        note_string_copy(identifier);
         if (auto global = globals_.find(identifier); global != globals_.end()) {
-            push(global->second);
+            push_unchecked(global->second);
         } else {
             throw_undefined_global(identifier);
         }
@@ -297,13 +501,13 @@ namespace lox
 
     void VM::op_set_local(std::uint8_t index)
     {
-        assert(stack_.size() > index && "incorrect stack address for local");
+        assert(stack_top_ - stack_.get() > index && "incorrect stack address for local");
         stack_[index] = peek();
     }
 
     void VM::op_get_local(std::uint8_t index)
     {
-        assert(stack_.size() > index && "incorrect stack address for local");
-        push(stack_[index]);
+        assert(stack_top_ - stack_.get() > index && "incorrect stack address for local");
+        push_unchecked(stack_[index]);
     }
 } // namespace lox
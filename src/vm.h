@@ -1,15 +1,29 @@
 #pragma once
 
+#include "bytecode.h"
+#include "allocation_stats.h"
 #include "error.h"
+#include "line_sampler.h"
 #include "lox_object.h"
+#include "trace.h"
 
+#if defined(LOX_PROFILE_OPS)
+    #include "op_profiler.h"
+#endif
+
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <memory>
 #include <span>
 #include <string>
 #include <vector>
 
 namespace lox
 {
+    struct CompileOutput;
+    class ExecutionTask;
+
     class VMTrap : public LoxError
     {
     public:
@@ -19,21 +33,97 @@ namespace lox
         }
     };
 
+    enum class ExecutionStatus {
+        Completed,
+        BudgetExhausted,
+        // Suspended on request of the host, see VM::request_suspend()
+        Suspended,
+    };
+
     class VM
     {
     public:
-        void execute(std::span<const std::uint8_t> code);
+        static constexpr std::size_t default_stack_size = 1024;
+        static constexpr std::uint64_t unlimited_budget = UINT64_MAX;
+
+        VM();
+        explicit VM(std::size_t stack_size);
+
+        // Checks the program's stack requirement once up front, its pushes are not bounds checked after that.
+        // The budget is the number of backward jumps & calls the program may perform before execution is
+        // suspended with ExecutionStatus::BudgetExhausted. The program must outlive a suspended execution
+        ExecutionStatus execute(const CompileOutput& program, std::uint64_t budget = unlimited_budget);
+        // Continues a suspended execution with a new budget
+        ExecutionStatus resume(std::uint64_t budget = unlimited_budget);
+        // Coroutine variant of execute(), suspends every time the slice budget runs out or a suspension is
+        // requested. Both the VM and the program must outlive the returned task
+        ExecutionTask execute_async(const CompileOutput& program, std::uint64_t slice_budget = unlimited_budget);
+        // Asks the VM to suspend at its next checkpoint with ExecutionStatus::Suspended, e.g. so a native
+        // can wait on an asynchronous host operation. Safe to call from another thread. A request still pending
+        // when the execution completes or fails is dropped
+        void request_suspend() { suspend_requested_.store(true, std::memory_order_relaxed); }
+
+        [[nodiscard]] bool is_suspended() const { return !bytecode_.is_eof(); }
 
+        // Lets the sampler record the line of the current instruction, see LineSampler. Without a sampler the
+        // VM runs a dispatch loop that doesn't check for samples at all. Pass nullptr to detach
+        void set_line_sampler(LineSampler* sampler) { line_sampler_ = sampler; }
+        // Appends the lines programs print to `output` instead of writing them to stdout, pass nullptr to restore
+        void set_output(std::string* output) { output_ = output; }
+        // Reports programs & conditional branches to the observer, e.g. to record or replay a trace. On its own it
+        // selects a dispatch loop that only adds work to conditional jumps. Pass nullptr to detach
+        void set_branch_observer(BranchObserver* observer) { branch_observer_ = observer; }
+        // Accounts the objects programs allocate from now on, see stats(). Like sampling this selects the
+        // instrumented dispatch loop. Objects are only accounted with LOX_ALLOCATION_STATS
+        void enable_allocation_stats();
+        // Empty unless enable_allocation_stats() was called, accumulated over every program run since. reset() keeps it
+        [[nodiscard]] const AllocationStats& stats() const;
+        // Counted by the instrumented dispatch loop only, i.e. while sampling or accounting allocations
+        [[nodiscard]] std::uint64_t instructions_executed() const { return instructions_executed_; }
+        // Budget used by every program run on this VM, i.e. backward jumps & calls. Counted by every dispatch
+        // loop, once per run rather than per checkpoint
+        [[nodiscard]] std::uint64_t checkpoints_passed() const { return checkpoints_passed_; }
+
+        // Registers a global that survives reset(), e.g. host provided native functions
+        void define_native(std::string name, LoxObjectRef value);
+        // Clears all user state (stack, constants & globals) while keeping allocated capacity and natives
+        void reset();
+
+        // Throws a stack overflow LoxError when the stack is full
         void push(LoxObjectRef object);
         LoxObjectRef pop();
         LoxObjectRef peek() const;
 
+        [[nodiscard]] std::size_t stack_size() const { return stack_end_ - stack_.get(); }
+
+#if defined(LOX_PROFILE_OPS)
+        // Accumulated over every program run on this VM, reset() keeps it
+        [[nodiscard]] const OpProfiler& op_profile() const { return op_profiler_; }
+#endif
+
     private:
+        void load_constants();
+        ExecutionStatus run(std::uint64_t budget);
+        // Dispatch loops are instantiated per level, unused hooks cost nothing
+        enum class Instrumentation : std::uint8_t {
+            None,
+            // Conditional branches are reported to the branch observer
+            Branches,
+            // Branches, line samples, allocation accounting & instruction counts
+            Full,
+        };
+
+        template <Instrumentation Level>
+        ExecutionStatus dispatch(std::uint64_t budget);
+
         [[noreturn]] void throw_unsupported_binary_op(const char* op, const LoxObject* lhs, const LoxObject* rhs) const;
         [[noreturn]] void throw_unsupported_unary_op(const char* op, const LoxObject* object) const;
         [[noreturn]] void throw_undefined_global(const std::string& identifier) const;
+        [[noreturn]] void throw_stack_overflow(std::size_t required) const;
 
-        [[nodiscard]] SourceLocation current_location() const { return {}; }
+        // Decodes the line & file of the instruction at `position` in the bytecode into `error`, only done when an
+        // error is raised
+        void locate(LoxError& error, std::size_t position) const;
 
         void op_add();
         void op_sub();
@@ -56,8 +146,31 @@ namespace lox
         void op_set_local(std::uint8_t index);
         void op_get_local(std::uint8_t index);
 
-        std::vector<LoxObjectRef> stack_;
+        // Pushes from instructions, the stack requirement checked by execute() covers them
+        void push_unchecked(LoxObjectRef object);
+        void unwind_stack();
+        void note_string_copy(const std::string& string);
+        void observe_branch(const Bytecode& bytecode, bool taken);
+
+        std::unique_ptr<LoxObjectRef[]> stack_;
+        LoxObjectRef* stack_top_;
+        LoxObjectRef* stack_end_;
+        Bytecode bytecode_{{}};
+        const CompileOutput* program_ = nullptr;
+        // Position of the first instruction, line table offsets are relative to it
+        std::size_t code_start_ = 0;
+        LineSampler* line_sampler_ = nullptr;
+        std::string* output_ = nullptr;
+        BranchObserver* branch_observer_ = nullptr;
+        std::unique_ptr<AllocationStats> allocation_stats_;
+        std::uint64_t instructions_executed_ = 0;
+        std::uint64_t checkpoints_passed_ = 0;
+        std::atomic<bool> suspend_requested_ = false;
         std::vector<LoxObjectRef> constants_;
         std::map<std::string, LoxObjectRef, std::less<>> globals_;
+        std::map<std::string, LoxObjectRef, std::less<>> natives_;
+#if defined(LOX_PROFILE_OPS)
+        OpProfiler op_profiler_;
+#endif
     };
 } // namespace lox
@@ -57,6 +57,82 @@ namespace lox
                 return "jmp_true";
             case Instruction::JmpSigned:
                 return "jmp_signed";
+            case Instruction::Call:
+                return "call";
         }
     }
+
+    int stack_effect(Instruction instruction)
+    {
+        switch (instruction) {
+            case Instruction::PushConstant:
+            case Instruction::PushNil:
+            case Instruction::PushTrue:
+            case Instruction::PushFalse:
+            case Instruction::GetGlobal:
+            case Instruction::GetLocal:
+            case Instruction::Call:
+                return 1;
+            case Instruction::Add:
+            case Instruction::Sub:
+            case Instruction::Mul:
+            case Instruction::Div:
+            case Instruction::Less:
+            case Instruction::Greater:
+            case Instruction::Equal:
+            case Instruction::Pop:
+            case Instruction::Print:
+            case Instruction::DefineGlobal:
+                return -1;
+            case Instruction::Nop:
+            case Instruction::Neg:
+            case Instruction::Not:
+            case Instruction::SetGlobal:
+            case Instruction::SetLocal:
+            case Instruction::Jmp:
+            case Instruction::JmpFalse:
+            case Instruction::JmpTrue:
+            case Instruction::JmpSigned:
+            case Instruction::Trap:
+                return 0;
+        }
+        return 0;
+    }
+
+    int operand_size(Instruction instruction)
+    {
+        switch (instruction) {
+            case Instruction::PushConstant:
+            case Instruction::DefineGlobal:
+            case Instruction::SetGlobal:
+            case Instruction::GetGlobal:
+            case Instruction::SetLocal:
+            case Instruction::GetLocal:
+                return 1;
+            case Instruction::Jmp:
+            case Instruction::JmpFalse:
+            case Instruction::JmpTrue:
+            case Instruction::JmpSigned:
+                return 2;
+            case Instruction::Nop:
+            case Instruction::Add:
+            case Instruction::Sub:
+            case Instruction::Mul:
+            case Instruction::Div:
+            case Instruction::Neg:
+            case Instruction::Not:
+            case Instruction::Less:
+            case Instruction::Greater:
+            case Instruction::Equal:
+            case Instruction::PushNil:
+            case Instruction::PushTrue:
+            case Instruction::PushFalse:
+            case Instruction::Pop:
+            case Instruction::Print:
+            case Instruction::Call:
+            case Instruction::Trap:
+                return 0;
+        }
+        return 0;
+    }
 } // namespace lox
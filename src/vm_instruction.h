@@ -30,8 +30,16 @@ namespace lox
         JmpFalse,
         JmpTrue,
         JmpSigned,
+        // Traps until calls are implemented, but leaves the call's result on the stack as far as the compiler's
+        // depth tracking is concerned
+        Call,
         Trap = UINT8_MAX,
     };
 
     const char* format_as(Instruction instruction);
+
+    // Net change in stack height caused by executing the instruction
+    int stack_effect(Instruction instruction);
+    // Number of operand bytes following the instruction in the bytecode
+    int operand_size(Instruction instruction);
 } // namespace lox
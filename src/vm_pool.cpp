@@ -0,0 +1,68 @@
+#include "vm_pool.h"
+
+namespace lox
+{
+    PooledVM::PooledVM(VMPool* pool, std::unique_ptr<VM> vm)
+        : pool_(pool)
+        , vm_(std::move(vm))
+    {
+    }
+
+    PooledVM::~PooledVM()
+    {
+        if (vm_ != nullptr) {
+            vm_->reset();
+            pool_->release(std::move(vm_));
+        }
+    }
+
+    VMPool::VMPool(std::size_t size, std::size_t stack_size)
+        : stack_size_(stack_size)
+    {
+        idle_.reserve(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            idle_.push_back(make_vm());
+        }
+    }
+
+    PooledVM VMPool::acquire()
+    {
+        const auto lock = std::scoped_lock{mutex_};
+        if (idle_.empty()) {
+            return PooledVM{this, make_vm()};
+        }
+        auto vm = std::move(idle_.back());
+        idle_.pop_back();
+        return PooledVM{this, std::move(vm)};
+    }
+
+    void VMPool::define_native(std::string name, LoxObjectRef value)
+    {
+        const auto lock = std::scoped_lock{mutex_};
+        for (auto& vm : idle_) {
+            vm->define_native(name, value);
+        }
+        natives_[std::move(name)] = std::move(value);
+    }
+
+    std::size_t VMPool::idle_count() const
+    {
+        const auto lock = std::scoped_lock{mutex_};
+        return idle_.size();
+    }
+
+    std::unique_ptr<VM> VMPool::make_vm() const
+    {
+        auto vm = std::make_unique<VM>(stack_size_);
+        for (const auto& [name, value] : natives_) {
+            vm->define_native(name, value);
+        }
+        return vm;
+    }
+
+    void VMPool::release(std::unique_ptr<VM> vm)
+    {
+        const auto lock = std::scoped_lock{mutex_};
+        idle_.push_back(std::move(vm));
+    }
+} // namespace lox
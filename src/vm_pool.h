@@ -0,0 +1,63 @@
+#pragma once
+
+#include "lox_object.h"
+#include "vm.h"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lox
+{
+    class VMPool;
+
+    // Exclusive handle to a VM borrowed from a VMPool. The VM is reset and handed back to the pool on destruction
+    class PooledVM
+    {
+    public:
+        PooledVM(VMPool* pool, std::unique_ptr<VM> vm);
+        ~PooledVM();
+
+        PooledVM(const PooledVM&) = delete;
+        PooledVM(PooledVM&&) noexcept = default;
+        PooledVM& operator=(const PooledVM&) = delete;
+        PooledVM& operator=(PooledVM&&) = delete;
+
+        [[nodiscard]] VM& operator*() const { return *vm_; }
+        [[nodiscard]] VM* operator->() const { return vm_.get(); }
+        [[nodiscard]] VM* get() const { return vm_.get(); }
+
+    private:
+        VMPool* pool_;
+        std::unique_ptr<VM> vm_;
+    };
+
+    class VMPool
+    {
+    public:
+        explicit VMPool(std::size_t size, std::size_t stack_size = VM::default_stack_size);
+
+        // Hands out an idle VM, creating a new one if the pool is exhausted
+        PooledVM acquire();
+
+        // Registers a native on every idle VM and on VMs created later.
+        // Natives should be registered before VMs are handed out, leased VMs are not updated
+        void define_native(std::string name, LoxObjectRef value);
+
+        [[nodiscard]] std::size_t idle_count() const;
+
+    private:
+        friend class PooledVM;
+
+        std::unique_ptr<VM> make_vm() const;
+        void release(std::unique_ptr<VM> vm);
+
+        std::size_t stack_size_;
+        mutable std::mutex mutex_;
+        std::vector<std::unique_ptr<VM>> idle_;
+        std::map<std::string, LoxObjectRef, std::less<>> natives_;
+    };
+} // namespace lox
@@ -0,0 +1,60 @@
+#include "allocation_stats.h"
+
+#include "bytecode_compiler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "vm.h"
+
+#include <gtest/gtest.h>
+
+namespace lox
+{
+    namespace
+    {
+        CompileOutput compile(const char* source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto statements = parser.parse();
+            EXPECT_TRUE(statements.has_value());
+            auto compiler = BytecodeCompiler{};
+            auto output = compiler.compile(*statements);
+            EXPECT_TRUE(output.has_value());
+            return *output;
+        }
+
+        TEST(AllocationStats, SelectsInstrumentedLoop)
+        {
+            auto vm = VM{};
+            vm.execute(compile("var n = 0;"));
+            EXPECT_EQ(vm.instructions_executed(), 0);
+
+            vm.enable_allocation_stats();
+            vm.execute(compile("var n = 0;"));
+            EXPECT_EQ(vm.instructions_executed(), 2);
+        }
+
+#if defined(LOX_ALLOCATION_STATS)
+        TEST(AllocationStats, CountsByTypeAndInstruction)
+        {
+            auto vm = VM{};
+            vm.execute(compile("var n = 0;"));
+            EXPECT_EQ(vm.stats().total().count, 0);
+
+            vm.enable_allocation_stats();
+            vm.execute(compile("var a_long_global_name = 0; while (a_long_global_name < 10) a_long_global_name = a_long_global_name + 1; print !nil;"));
+            const auto& stats = vm.stats();
+            EXPECT_EQ(stats.by_instruction(Instruction::Add).count, 10);
+            EXPECT_EQ(stats.by_instruction(Instruction::Not).count, 0);
+            // Constants are attributed to their type but not to an instruction
+            EXPECT_EQ(stats.by_type("Number").count, 13);
+            EXPECT_EQ(stats.by_type("String").count, 1);
+            EXPECT_EQ(stats.total().count, 14);
+            EXPECT_EQ(stats.total().bytes, stats.by_type("Number").bytes + stats.by_type("String").bytes);
+            EXPECT_GT(stats.peak_live_bytes(), stats.live_bytes());
+            // One define, 11 loads in the condition, 10 loads & 10 stores in the body
+            EXPECT_EQ(stats.string_copies().count, 32);
+        }
+#endif
+    } // namespace
+} // namespace lox
@@ -0,0 +1,144 @@
+#include "bundle.h"
+
+#include "bytecode_compiler.h"
+#include "disassembler.h"
+#include "error.h"
+#include "lexer.h"
+#include "linker.h"
+#include "parser.h"
+#include "vm.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace lox
+{
+    namespace
+    {
+        CompileOutput compile(const std::string& source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto statements = parser.parse();
+            EXPECT_TRUE(statements.has_value());
+            auto compiler = BytecodeCompiler{};
+            auto output = compiler.compile(*statements);
+            EXPECT_TRUE(output.has_value());
+            return *output;
+        }
+
+        const auto sources = std::vector<std::string>{
+            "var greeting = \"hello\"; var count = 3;",
+            "{ var local = count * 2; print greeting; print local; }",
+            "var farewell = \"bye\"; while (count > 0) { count = count - 1; print 1.5; }",
+        };
+
+        // Directory of its own for the running test, removed with everything in it however the test ends
+        class TestDirectory
+        {
+        public:
+            TestDirectory()
+                : path_(std::filesystem::path{::testing::TempDir()} / test_name())
+            {
+                std::filesystem::remove_all(path_);
+                std::filesystem::create_directories(path_);
+            }
+            TestDirectory(const TestDirectory&) = delete;
+            TestDirectory& operator=(const TestDirectory&) = delete;
+            ~TestDirectory()
+            {
+                std::error_code error;
+                std::filesystem::remove_all(path_, error);
+            }
+
+            [[nodiscard]] std::string path(const std::string& name) const { return (path_ / name).string(); }
+
+            // Writes `source` to a file named `name` in the directory, returning its path
+            std::string write(const std::string& name, const std::string& source) const
+            {
+                const auto file = path(name);
+                std::ofstream{file} << source;
+                return file;
+            }
+
+        private:
+            static std::string test_name()
+            {
+                const auto* info = ::testing::UnitTest::GetInstance()->current_test_info();
+                return std::string{"lox_"} + info->test_suite_name() + "_" + info->name();
+            }
+
+            std::filesystem::path path_;
+        };
+
+        std::string concatenated_sources()
+        {
+            std::string source;
+            for (const auto& unit : sources) {
+                source += unit;
+            }
+            return source;
+        }
+
+        TEST(Linker, MatchesSingleUnit)
+        {
+            std::vector<CompileOutput> units;
+            for (const auto& source : sources) {
+                units.push_back(compile(source));
+            }
+            const auto linked = link(units);
+            ASSERT_TRUE(linked.has_value());
+
+            const auto expected = compile(concatenated_sources());
+            EXPECT_EQ(disassemble(linked->bytecode), disassemble(expected.bytecode));
+            EXPECT_EQ(linked->max_stack_depth, expected.max_stack_depth);
+        }
+
+        TEST(Bundle, LoadsFilesInOrder)
+        {
+            const auto directory = TestDirectory{};
+            std::vector<std::string> filenames;
+            for (std::size_t i = 0; i < sources.size(); ++i) {
+                filenames.push_back(directory.write("unit" + std::to_string(i) + ".lox", sources[i]));
+            }
+
+            const auto bundle = load_bundle(filenames, 2);
+            ASSERT_TRUE(bundle.has_value());
+            EXPECT_EQ(disassemble(bundle->bytecode), disassemble(compile(concatenated_sources()).bytecode));
+
+            filenames.push_back(directory.path("missing.lox"));
+            const auto missing = load_bundle(filenames, 2);
+            ASSERT_FALSE(missing.has_value());
+            EXPECT_EQ(missing.error().size(), 1);
+        }
+
+        TEST(Bundle, RuntimeErrorsNameTheFile)
+        {
+            const auto directory = TestDirectory{};
+            const auto filenames = std::vector{
+                directory.write("first.lox", "var a = 1;\nprint a;\n"),
+                directory.write("second.lox", "print a;\n\nprint a + nil;\n"),
+            };
+            const auto bundle = load_bundle(filenames, 2);
+            ASSERT_TRUE(bundle.has_value());
+            EXPECT_EQ(bundle->files, filenames);
+
+            auto output = std::string{};
+            auto vm = VM{};
+            vm.set_output(&output);
+            try {
+                vm.execute(*bundle);
+                FAIL() << "expected a runtime error";
+            } catch (const LoxError& error) {
+                EXPECT_EQ(error.location().line, 3);
+                EXPECT_TRUE(std::string_view{error.what()}.starts_with(filenames[1] + ": [3] Error: "));
+            }
+        }
+    } // namespace
+} // namespace lox
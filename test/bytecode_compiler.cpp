@@ -0,0 +1,180 @@
+#include "bytecode_compiler.h"
+
+#include "disassembler.h"
+#include "lexer.h"
+#include "parser.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+namespace lox
+{
+    namespace
+    {
+        CompileOutput compile(const char* source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto statements = parser.parse();
+            EXPECT_TRUE(statements.has_value());
+            auto compiler = BytecodeCompiler{};
+            auto output = compiler.compile(*statements);
+            EXPECT_TRUE(output.has_value());
+            return *output;
+        }
+
+        TEST(BytecodeCompiler, MaxStackDepthExpression)
+        {
+            EXPECT_EQ(compile("").max_stack_depth, 0);
+            EXPECT_EQ(compile("print 1;").max_stack_depth, 1);
+            EXPECT_EQ(compile("print 1 + 2 * 3;").max_stack_depth, 3);
+            EXPECT_EQ(compile("print (1 + 2) * 3;").max_stack_depth, 2);
+        }
+
+        TEST(BytecodeCompiler, MaxStackDepthCall)
+        {
+            // Calls trap for now, their result still counts towards the depth
+            const auto output = compile("var f; print f() + 1;");
+            EXPECT_EQ(output.max_stack_depth, 2);
+            EXPECT_NE(disassemble(output.bytecode).find("call"), std::string::npos);
+        }
+
+        TEST(BytecodeCompiler, MaxStackDepthLocals)
+        {
+            EXPECT_EQ(compile("{ var a = 1; var b = 2; print a + b; }").max_stack_depth, 4);
+            EXPECT_EQ(compile("{ var a = 1; } { var b = 1; }").max_stack_depth, 1);
+        }
+
+        TEST(BytecodeCompiler, MaxStackDepthControlFlow)
+        {
+            EXPECT_EQ(compile("if (true) print 1; else print 2; print 3;").max_stack_depth, 1);
+            EXPECT_EQ(compile("var i = 0; while (i < 10) { i = i + 1; }").max_stack_depth, 2);
+            EXPECT_EQ(compile("print true and 1 + 2;").max_stack_depth, 2);
+            EXPECT_EQ(compile("for (var i = 0; i < 2; i = i + 1) { var a = i; print a; }").max_stack_depth, 3);
+        }
+
+        TEST(BytecodeCompiler, LocalInOwnInitializer)
+        {
+            auto lexer = Lexer{"var a = 1; { var a = a + 1; }"};
+            auto parser = Parser{lexer};
+            const auto statements = parser.parse();
+            ASSERT_TRUE(statements.has_value());
+            auto compiler = BytecodeCompiler{};
+            const auto output = compiler.compile(*statements);
+            ASSERT_FALSE(output.has_value());
+            EXPECT_EQ(output.error().message, "can't read local variable 'a' in its own initializer");
+            EXPECT_EQ(compile("{ var a = 1; { var b = a; } }").max_stack_depth, 2);
+        }
+
+        TEST(BytecodeCompiler, PointerTreeAdapter)
+        {
+            // Keywords, braces & operators on lines of their own, so every node's offset shows in the line table
+            const auto source = std::string_view{"var a = 1;\nwhile\n(a < 3)\n  a = a + 1;\nif\n(a > 2)\n{\n  print\n  (a\n  + 2);\n}\na\n+ 0;"};
+            // The first `lexeme` at or after `anchor`
+            const auto token = [source](TokenType type, std::string_view anchor, std::string_view lexeme) {
+                return Token{type, static_cast<std::uint32_t>(source.find(lexeme, source.find(anchor))), static_cast<std::uint32_t>(lexeme.size())};
+            };
+            const auto var = [&](std::string_view anchor) { return std::make_unique<VarExpr>(token(TokenType::Identifier, anchor, "a")); };
+            const auto number = [&](std::string_view anchor, std::string_view lexeme, double value) {
+                return std::make_unique<LiteralExpr>(token(TokenType::Number, anchor, lexeme), value);
+            };
+
+            std::vector<StmtPtr> statements;
+            statements.push_back(std::make_unique<VarDeclStmt>(token(TokenType::Identifier, "a = 1", "a"), number("= 1", "1", 1.0)));
+            statements.push_back(std::make_unique<WhileStmt>(
+                token(TokenType::While, "while", "while"),
+                std::make_unique<BinaryExpr>(var("(a < 3)"), token(TokenType::Less, "(a < 3)", "<"), number("< 3", "3", 3.0)),
+                std::make_unique<ExprStmt>(std::make_unique<AssignmentExpr>(
+                    token(TokenType::Identifier, "a = a + 1", "a"),
+                    std::make_unique<BinaryExpr>(var("= a + 1"), token(TokenType::Plus, "a + 1", "+"), number("+ 1", "1", 1.0))))));
+            std::vector<StmtPtr> block;
+            block.push_back(std::make_unique<PrintStmt>(
+                token(TokenType::Print, "print", "print"),
+                std::make_unique<ParenExpr>(token(TokenType::LeftParen, "(a\n", "("),
+                                            std::make_unique<BinaryExpr>(var("(a\n"), token(TokenType::Plus, "+ 2", "+"), number("+ 2", "2", 2.0)))));
+            statements.push_back(std::make_unique<IfStmt>(
+                token(TokenType::If, "if", "if"),
+                std::make_unique<BinaryExpr>(var("(a > 2)"), token(TokenType::Greater, "(a > 2)", ">"), number("> 2", "2", 2.0)),
+                std::make_unique<BlockStmt>(token(TokenType::LeftBrace, "{", "{"), std::move(block)),
+                nullptr));
+            statements.push_back(std::make_unique<ExprStmt>(std::make_unique<BinaryExpr>(var("\na\n"), token(TokenType::Plus, "+ 0", "+"), number("+ 0", "0", 0.0))));
+
+            auto compiler = BytecodeCompiler{};
+            const auto output = compiler.compile(statements, source);
+            ASSERT_TRUE(output.has_value());
+            const auto expected = compile(source.data());
+            EXPECT_EQ(disassemble(output->bytecode), disassemble(expected.bytecode));
+            EXPECT_EQ(output->max_stack_depth, expected.max_stack_depth);
+            EXPECT_TRUE(std::ranges::equal(output->lines.runs(), expected.lines.runs()));
+            // The while keyword's line has code of its own, the loop's jumps
+            EXPECT_TRUE(std::ranges::any_of(expected.lines.runs(), [](const LineRun& run) { return run.line == 2; }));
+        }
+
+        TEST(BytecodeCompiler, LineTable)
+        {
+            const auto output = compile("var a = 0;\nwhile (a < 3)\n  a = a + 1;\nprint a;");
+            // The loop's jumps & the pop of its condition belong to the while statement
+            const auto expected = std::vector<LineRun>{{1, 4}, {2, 9}, {3, 8}, {2, 4}, {4, 3}};
+            EXPECT_TRUE(std::ranges::equal(output.lines.runs(), expected));
+            EXPECT_EQ(output.lines.line_at(0), 1);
+            EXPECT_EQ(output.lines.line_at(13), 3);
+            EXPECT_EQ(output.lines.line_at(27), 4);
+            EXPECT_EQ(output.lines.line_at(28), 0);
+        }
+
+        TEST(LineTable, MergesRuns)
+        {
+            auto lines = LineTable{};
+            lines.add(1, 2);
+            lines.add(1, 3);
+            lines.add(2, 0);
+            lines.add(3, 1);
+            auto other = LineTable{};
+            other.add(3, 2);
+            other.add(1, 1);
+            lines.append(other);
+            EXPECT_TRUE(std::ranges::equal(lines.runs(), std::vector<LineRun>{{1, 5}, {3, 3}, {1, 1}}));
+
+            EXPECT_EQ(lines.size_bytes(), 4); // the last run is still open
+
+            lines.shift_lines(2);
+            EXPECT_EQ(lines.line_at(4), 3);
+            EXPECT_EQ(lines.line_at(5), 5);
+            EXPECT_EQ(lines.line_at(8), 3);
+        }
+
+        TEST(LineTable, LargeDeltas)
+        {
+            auto lines = LineTable{};
+            lines.add(100000, 300);
+            lines.add(2, 1);
+            lines.add(70000, 1);
+            EXPECT_TRUE(std::ranges::equal(lines.runs(), std::vector<LineRun>{{100000, 300}, {2, 1}, {70000, 1}}));
+            EXPECT_EQ(lines.line_at(299), 100000);
+            EXPECT_EQ(lines.line_at(300), 2);
+            EXPECT_EQ(lines.line_at(301), 70000);
+        }
+
+        TEST(LineTable, KeepsFiles)
+        {
+            auto unit = LineTable{};
+            unit.add(1, 3);
+            unit.add(2, 1);
+            auto lines = LineTable{};
+            lines.append(unit, 0, 0);
+            lines.append(unit, 0, 1);
+            const auto mark = lines.mark();
+            lines.append(unit, 0, 2);
+            EXPECT_TRUE(std::ranges::equal(lines.runs(), std::vector<LineRun>{{1, 3, 0}, {2, 1, 0}, {1, 3, 1}, {2, 1, 1}, {1, 3, 2}, {2, 1, 2}}));
+            EXPECT_EQ(lines.run_at(5).file, 1);
+            EXPECT_EQ(lines.run_at(8), (LineRun{.line = 1, .length = 3, .file = 2}));
+
+            lines.rewind(mark);
+            lines.append(unit, 0, 1);
+            EXPECT_TRUE(std::ranges::equal(lines.runs(), std::vector<LineRun>{{1, 3, 0}, {2, 1, 0}, {1, 3, 1}, {2, 1, 1}, {1, 3, 1}, {2, 1, 1}}));
+        }
+    } // namespace
+} // namespace lox
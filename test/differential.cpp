@@ -0,0 +1,50 @@
+#include "differential.h"
+#include "source_file.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+
+namespace lox::fuzz
+{
+    namespace
+    {
+        void expect_same_in_all_modes(std::string_view source)
+        {
+            if (const auto mismatch = run_all_modes(source)) {
+                ADD_FAILURE() << describe(*mismatch);
+            }
+        }
+
+        TEST(Differential, Samples)
+        {
+            for (const auto& entry : std::filesystem::directory_iterator{LOX_SAMPLES_DIR}) {
+                auto file = SourceFile::open(entry.path().string().c_str());
+                ASSERT_TRUE(file.has_value()) << file.error();
+                SCOPED_TRACE(entry.path().filename().string());
+                expect_same_in_all_modes(file->text());
+            }
+        }
+
+        TEST(Differential, RuntimeErrorAfterOutput)
+        {
+            expect_same_in_all_modes("var i = 0;\nwhile (i < 10) {\n  print i;\n  if (i == 6) i = -nil;\n  i = i + 1;\n}\n");
+            EXPECT_EQ(run("print 1; print -true;", ExecutionMode::Sliced).output, "1\n");
+        }
+
+        TEST(Differential, CompileErrors)
+        {
+            expect_same_in_all_modes("print 1;\nvar = 2;\nprint 3;\n");
+            EXPECT_FALSE(run("{ var a = a; }", ExecutionMode::Incremental).error.empty());
+        }
+
+        TEST(Differential, BudgetStopsInfiniteLoops)
+        {
+            const auto source = "var n = 0; while (true) { n = n + 1; if (n == 4096) print n; if (n == 4097) print n; }";
+            expect_same_in_all_modes(source);
+            const auto outcome = run(source, ExecutionMode::Direct);
+            EXPECT_EQ(outcome.output, "4096\n");
+            EXPECT_EQ(outcome.error, "budget exhausted");
+        }
+    } // namespace
+} // namespace lox::fuzz
@@ -0,0 +1,110 @@
+#include "bytecode_compiler.h"
+#include "source_file.h"
+#include "vm.h"
+#include "workloads.h"
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Runs every sample in lox/ & the benchmark workloads under the instrumented VM and compares deterministic metrics
+// against test/golden/<name>.golden. Regenerate the files with LOX_UPDATE_GOLDEN=1 after an intended change to the
+// compiler or the VM and review the diff like any other change. Allocations are only checked, and only regenerated
+// from, builds configured with -DLOX_ALLOCATION_STATS=ON
+namespace lox
+{
+    namespace
+    {
+        struct Workload {
+            std::string name;
+            std::string source;
+        };
+
+        std::vector<Workload> workloads()
+        {
+            std::vector<Workload> result;
+            for (const auto& entry : std::filesystem::directory_iterator{LOX_SAMPLES_DIR}) {
+                if (entry.path().extension() != ".lox") {
+                    continue;
+                }
+                auto file = SourceFile::open(entry.path().string().c_str());
+                if (!file) {
+                    ADD_FAILURE() << file.error();
+                    continue;
+                }
+                result.push_back({.name = entry.path().stem().string(), .source = std::string{file->text()}});
+            }
+            result.push_back({.name = "numeric_loop", .source = bench::numeric_loop_source()});
+            result.push_back({.name = "string_concat", .source = bench::string_concat_source()});
+            result.push_back({.name = "global_heavy", .source = bench::global_heavy_source()});
+            result.push_back({.name = "deep_scopes", .source = bench::deep_scopes_source()});
+            std::ranges::sort(result, {}, &Workload::name);
+            return result;
+        }
+
+        // One "<metric> <value>" per line
+        std::string metrics(const std::string& source)
+        {
+            const auto program = bench::compile(source);
+            auto vm = VM{};
+            vm.enable_allocation_stats();
+            testing::internal::CaptureStdout();
+            vm.execute(program);
+            testing::internal::GetCapturedStdout();
+            auto result = fmt::format("bytecode_bytes {}\nmax_stack_depth {}\ninstructions {}\n",
+                                      program.bytecode.size(),
+                                      program.max_stack_depth,
+                                      vm.instructions_executed());
+#if defined(LOX_ALLOCATION_STATS)
+            // Allocated bytes are left out, object sizes depend on the standard library
+            result += fmt::format("allocations {}\n", vm.stats().total().count);
+#endif
+            return result;
+        }
+
+        // The golden file without the metrics this build doesn't measure
+        std::string expected_metrics(std::istream& file)
+        {
+            std::string expected;
+            for (std::string line; std::getline(file, line);) {
+#if !defined(LOX_ALLOCATION_STATS)
+                if (line.starts_with("allocations ")) {
+                    continue;
+                }
+#endif
+                expected += line + '\n';
+            }
+            return expected;
+        }
+
+        class Golden : public testing::TestWithParam<Workload>
+        {
+        };
+
+        TEST_P(Golden, Metrics)
+        {
+            const auto& workload = GetParam();
+            const auto actual = metrics(workload.source);
+            const auto path = std::filesystem::path{LOX_GOLDEN_DIR} / (workload.name + ".golden");
+#if defined(LOX_ALLOCATION_STATS)
+            if (const auto* update = std::getenv("LOX_UPDATE_GOLDEN"); update != nullptr && std::string{update} == "1") {
+                std::ofstream{path} << actual;
+                return;
+            }
+#endif
+            auto file = std::ifstream{path};
+            ASSERT_TRUE(file) << path << " is missing, run with LOX_UPDATE_GOLDEN=1 to create it";
+            EXPECT_EQ(actual, expected_metrics(file)) << "run with LOX_UPDATE_GOLDEN=1 if the change is intended";
+        }
+
+        INSTANTIATE_TEST_SUITE_P(Samples, Golden, testing::ValuesIn(workloads()), [](const auto& info) { return info.param.name; });
+    } // namespace
+} // namespace lox
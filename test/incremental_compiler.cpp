@@ -0,0 +1,157 @@
+#include "incremental_compiler.h"
+
+#include "disassembler.h"
+#include "lexer.h"
+#include "parser.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lox
+{
+    namespace
+    {
+        CompileOutput compile(const std::string& source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto statements = parser.parse();
+            EXPECT_TRUE(statements.has_value());
+            auto compiler = BytecodeCompiler{};
+            auto output = compiler.compile(*statements);
+            EXPECT_TRUE(output.has_value());
+            return *output;
+        }
+
+        std::vector<std::string_view> split(std::string_view source)
+        {
+            std::vector<std::string_view> texts;
+            for (const auto span : split_declarations(source)) {
+                texts.push_back(source.substr(span.begin, span.end - span.begin));
+            }
+            return texts;
+        }
+
+        TEST(IncrementalCompiler, SplitDeclarations)
+        {
+            const auto source = std::string_view{R"(
+                var a = 1; // comment ;
+                if (a) { print "}"; } else print 2;
+                for (var i = 0; i < 2; i = i + 1) print i;
+                fun f() { return 1; }
+                { var b = a; })"};
+            const auto expected = std::vector<std::string_view>{
+                "var a = 1;",
+                R"(if (a) { print "}"; } else print 2;)",
+                "for (var i = 0; i < 2; i = i + 1) print i;",
+                "fun f() { return 1; }",
+                "{ var b = a; }",
+            };
+            EXPECT_EQ(split(source), expected);
+        }
+
+        TEST(IncrementalCompiler, RecompilesChangedStatements)
+        {
+            auto source = std::string{"var a = \"one\";\nvar b = 2;\nwhile (b > 0) { b = b - 1; print a; }\nprint b;\n"};
+            auto compiler = IncrementalCompiler{};
+            const auto first = compiler.compile(source);
+            ASSERT_TRUE(first.has_value());
+            EXPECT_EQ(compiler.compiled_count(), 4);
+            EXPECT_EQ(compiler.reused_count(), 0);
+            EXPECT_EQ(disassemble(first->bytecode), disassemble(compile(source).bytecode));
+
+            source.replace(source.find("var b = 2;"), 10, "var b = 3.5;");
+            const auto second = compiler.compile(source);
+            ASSERT_TRUE(second.has_value());
+            EXPECT_EQ(compiler.compiled_count(), 1);
+            EXPECT_EQ(compiler.reused_count(), 3);
+            EXPECT_EQ(disassemble(second->bytecode), disassemble(compile(source).bytecode));
+        }
+
+        TEST(IncrementalCompiler, ShiftsLinesOfReusedStatements)
+        {
+            auto compiler = IncrementalCompiler{};
+            auto source = std::string{"var a = 1;\nprint a;\n"};
+            ASSERT_TRUE(compiler.compile(source).has_value());
+
+            source.insert(0, "var b = 2;\n\n");
+            const auto moved = compiler.compile(source);
+            ASSERT_TRUE(moved.has_value());
+            EXPECT_EQ(compiler.reused_count(), 2);
+            EXPECT_TRUE(std::ranges::equal(moved->lines.runs(), compile(source).lines.runs()));
+            EXPECT_EQ(moved->lines.line_at(moved->lines.runs().front().length), 3);
+        }
+
+        TEST(IncrementalCompiler, RelinksFromFirstChange)
+        {
+            auto source = std::string{"var a = 1;\nvar b = 2;\nprint a + b;\nprint a - b;\n"};
+            auto compiler = IncrementalCompiler{};
+            ASSERT_TRUE(compiler.compile(source).has_value());
+            EXPECT_EQ(compiler.linked_count(), 4);
+
+            ASSERT_TRUE(compiler.compile(source).has_value());
+            EXPECT_EQ(compiler.compiled_count(), 0);
+            EXPECT_EQ(compiler.linked_count(), 0);
+
+            source.replace(source.find("a - b"), 5, "a * b");
+            const auto last = compiler.compile(source);
+            ASSERT_TRUE(last.has_value());
+            EXPECT_EQ(compiler.compiled_count(), 1);
+            EXPECT_EQ(compiler.linked_count(), 1);
+            EXPECT_EQ(disassemble(last->bytecode), disassemble(compile(source).bytecode));
+
+            // The statements after an edit are linked again, but not compiled
+            source.replace(source.find("var b = 2;"), 10, "var b = 3;");
+            const auto middle = compiler.compile(source);
+            ASSERT_TRUE(middle.has_value());
+            EXPECT_EQ(compiler.compiled_count(), 1);
+            EXPECT_EQ(compiler.linked_count(), 3);
+            EXPECT_EQ(disassemble(middle->bytecode), disassemble(compile(source).bytecode));
+        }
+
+        TEST(IncrementalCompiler, MatchesFullCompileAcrossEdits)
+        {
+            auto compiler = IncrementalCompiler{};
+            auto source = std::string{"var a = 1;\nif (a > 0) { print a; }\nprint \"x\";\nwhile (a < 3) a = a + 1;\nprint a;\n"};
+            const auto check = [&] {
+                const auto program = compiler.compile(source);
+                ASSERT_TRUE(program.has_value()) << source;
+                const auto expected = compile(source);
+                EXPECT_EQ(disassemble(program->bytecode), disassemble(expected.bytecode)) << source;
+                EXPECT_TRUE(std::ranges::equal(program->lines.runs(), expected.lines.runs())) << source;
+            };
+            check();
+            // An else continues the if statement before it
+            source.insert(source.find("\nprint \"x\""), " else print 0;");
+            check();
+            // Lines added in the middle move the statements after them
+            source.insert(source.find("while"), "\n\nvar c = 2;\n");
+            check();
+            // Whitespace only
+            source.insert(source.find("print a;\n"), "  ");
+            check();
+            // A statement removed
+            source.erase(source.find("var c = 2;\n"), 11);
+            check();
+            source.erase(0, source.find("while"));
+            source.insert(0, "var a = 0;");
+            check();
+        }
+
+        TEST(IncrementalCompiler, ErrorLocation)
+        {
+            auto compiler = IncrementalCompiler{};
+            const auto result = compiler.compile("var a = 1;\nprint ;\n");
+            ASSERT_FALSE(result.has_value());
+            ASSERT_EQ(result.error().size(), 1);
+            EXPECT_TRUE(result.error().front().starts_with("[2:"));
+
+            EXPECT_TRUE(compiler.compile("var a = 1;\nprint a;\n").has_value());
+            EXPECT_EQ(compiler.reused_count(), 1);
+        }
+    } // namespace
+} // namespace lox
@@ -1,8 +1,13 @@
 #include "lexer.h"
+#include "lexer_scan.h"
+#include "token_stream.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <array>
+#include <random>
+#include <string>
 
 namespace lox
 {
@@ -32,7 +37,7 @@ namespace lox
             auto lexer = Lexer{source};
             const auto token = lexer.tokenize_next();
             EXPECT_EQ(token.type, TokenType::Plus);
-            EXPECT_EQ(token.location, (SourceLocation{2, 1}));
+            EXPECT_EQ(lexer.location_of(token.offset), (SourceLocation{2, 1}));
         }
 
         TEST(Lexer, IgnoreCommentsEOF)
@@ -48,7 +53,7 @@ namespace lox
             auto lexer = Lexer{source};
             const auto token = lexer.tokenize_next();
             EXPECT_EQ(token.type, TokenType::Plus);
-            EXPECT_EQ(token.location, (SourceLocation{2, 1}));
+            EXPECT_EQ(lexer.location_of(token.offset), (SourceLocation{2, 1}));
         }
 
         TEST(Lexer, MultiCharTokens)
@@ -79,7 +84,7 @@ namespace lox
             auto lexer = Lexer{source};
             const auto token = lexer.tokenize_next();
             EXPECT_EQ(token.type, TokenType::String);
-            EXPECT_EQ(token.lexeme, "\"This is a string\"");
+            EXPECT_EQ(lexer.lexeme(token), "\"This is a string\"");
         }
 
         TEST(Lexer, MultilineStringLiteral)
@@ -88,7 +93,7 @@ namespace lox
             auto lexer = Lexer{source};
             const auto token = lexer.tokenize_next();
             EXPECT_EQ(token.type, TokenType::String);
-            EXPECT_EQ(token.lexeme, "\"This is a\nmultiline string\"");
+            EXPECT_EQ(lexer.lexeme(token), "\"This is a\nmultiline string\"");
         }
 
         TEST(Lexer, NumberLiteralEOF)
@@ -104,7 +109,7 @@ namespace lox
             auto lexer = Lexer{source};
             const auto token = lexer.tokenize_next();
             EXPECT_EQ(token.type, TokenType::Number);
-            EXPECT_EQ(token.lexeme, "123456789");
+            EXPECT_EQ(lexer.lexeme(token), "123456789");
         }
 
         TEST(Lexer, FloatingNumberLiteral)
@@ -113,7 +118,7 @@ namespace lox
             auto lexer = Lexer{source};
             const auto token = lexer.tokenize_next();
             EXPECT_EQ(token.type, TokenType::Number);
-            EXPECT_EQ(token.lexeme, "1234.56789");
+            EXPECT_EQ(lexer.lexeme(token), "1234.56789");
         }
 
         TEST(Lexer, Keywords)
@@ -125,6 +130,14 @@ namespace lox
             }
         }
 
+        TEST(Lexer, KeywordLookalikes)
+        {
+            const auto lookalikes = std::array{"an", "andd", "o", "iff", "fals", "nill", "print_", "Return", "a", "z", "whilE", "clasS", ""};
+            for (auto identifier : lookalikes) {
+                EXPECT_EQ(Lexer::classify_identifier(identifier), TokenType::Identifier) << identifier;
+            }
+        }
+
         TEST(Lexer, Identifier)
         {
             const auto valid_identifiers = std::array{
@@ -140,5 +153,90 @@ namespace lox
                 EXPECT_EQ(lexer.tokenize_next().type, TokenType::Identifier);
             }
         }
+
+        TEST(Lexer, LongWhitespaceAndComments)
+        {
+            const auto source = std::string(40, ' ') + "// " + std::string(70, '-') + "\n\t\t\n" + std::string(33, ' ') + "+";
+            auto lexer = Lexer{source};
+            const auto token = lexer.tokenize_next();
+            EXPECT_EQ(token.type, TokenType::Plus);
+            EXPECT_EQ(lexer.location_of(token.offset), (SourceLocation{3, 34}));
+        }
+
+        TEST(Lexer, LongIdentifier)
+        {
+            const auto identifier = std::string(50, 'a') + "_0123456789_" + std::string(20, 'Z');
+            const auto source = identifier + "+";
+            auto lexer = Lexer{source};
+            const auto token = lexer.tokenize_next();
+            EXPECT_EQ(token.type, TokenType::Identifier);
+            EXPECT_EQ(lexer.lexeme(token), identifier);
+            EXPECT_EQ(lexer.tokenize_next().type, TokenType::Plus);
+        }
+
+        TEST(Lexer, LocationAfterMultilineString)
+        {
+            const char* source = "\"first line\nsecond line\nthird\" +";
+            auto lexer = Lexer{source};
+            const auto string = lexer.tokenize_next();
+            EXPECT_EQ(lexer.location_of(string.offset), (SourceLocation{1, 1}));
+            EXPECT_EQ(lexer.location_of(lexer.tokenize_next().offset), (SourceLocation{3, 8}));
+        }
+
+        TEST(LineIndex, Locate)
+        {
+            const auto index = LineIndex{"ab\n\ncd\n"};
+            EXPECT_EQ(index.locate(0), (SourceLocation{1, 1}));
+            EXPECT_EQ(index.locate(2), (SourceLocation{1, 3}));
+            EXPECT_EQ(index.locate(3), (SourceLocation{2, 1}));
+            EXPECT_EQ(index.locate(5), (SourceLocation{3, 2}));
+            EXPECT_EQ(index.locate(7), (SourceLocation{4, 1}));
+        }
+
+        TEST(LexerScan, MatchesScalarScan)
+        {
+            constexpr auto alphabet = std::string_view{"  \t\r\n\n\"/az_AZ09+\x80\xff"};
+            auto rng = std::mt19937{42};
+            auto pick = std::uniform_int_distribution<std::size_t>{0, alphabet.size() - 1};
+            for (int round = 0; round < 200; ++round) {
+                std::string source(1 + round % 97, ' ');
+                for (auto& c : source) {
+                    c = alphabet[pick(rng)];
+                }
+                for (std::size_t from = 0; from <= source.size(); ++from) {
+                    auto expected_whitespace = from;
+                    while (expected_whitespace < source.size() && scan::is_whitespace(source[expected_whitespace])) {
+                        ++expected_whitespace;
+                    }
+                    auto expected_identifier = from;
+                    while (expected_identifier < source.size() && scan::is_alnum(source[expected_identifier])) {
+                        ++expected_identifier;
+                    }
+                    const auto expected_quote = std::min(source.find('"', from), source.size());
+
+                    EXPECT_EQ(scan::skip_whitespace(source, from), expected_whitespace);
+                    EXPECT_EQ(scan::identifier_end(source, from), expected_identifier);
+                    EXPECT_EQ(scan::find_char(source, from, '"'), expected_quote);
+                }
+            }
+        }
+
+        TEST(TokenStream, PeekAndConsume)
+        {
+            const char* source = "var a = 1;";
+            auto lexer = Lexer{source};
+            auto tokens = TokenStream{lexer};
+            EXPECT_EQ(tokens.peek().type, TokenType::Var);
+            EXPECT_EQ(tokens.peek(2).type, TokenType::Equal);
+            EXPECT_EQ(tokens.consume().type, TokenType::Var);
+            EXPECT_EQ(tokens.last().type, TokenType::Var);
+            EXPECT_EQ(lexer.lexeme(tokens.consume()), "a");
+            EXPECT_EQ(tokens.consume().type, TokenType::Equal);
+            EXPECT_EQ(tokens.consume().type, TokenType::Number);
+            EXPECT_EQ(tokens.peek(1).type, TokenType::Eof);
+            EXPECT_EQ(tokens.consume().type, TokenType::Semicolon);
+            EXPECT_EQ(tokens.last().type, TokenType::Semicolon);
+            EXPECT_EQ(tokens.consume().type, TokenType::Eof);
+        }
     } // namespace
 } // namespace lox
@@ -0,0 +1,89 @@
+#include "line_sampler.h"
+
+#include "bytecode_compiler.h"
+#include "lexer.h"
+#include "parser.h"
+#include "vm.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <csignal>
+#endif
+
+namespace lox
+{
+    namespace
+    {
+        CompileOutput compile(const char* source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto statements = parser.parse();
+            EXPECT_TRUE(statements.has_value());
+            auto compiler = BytecodeCompiler{};
+            auto output = compiler.compile(*statements);
+            EXPECT_TRUE(output.has_value());
+            return *output;
+        }
+
+        TEST(LineSampler, FoldedStacks)
+        {
+            auto sampler = LineSampler{};
+            sampler.record(3);
+            sampler.record(1);
+            sampler.record(3);
+            sampler.record(0);
+            EXPECT_EQ(sampler.samples(3), 2);
+            EXPECT_EQ(sampler.total_samples(), 4);
+            EXPECT_EQ(sampler.folded("main.lox"), "main.lox;main.lox:? 1\nmain.lox;main.lox:1 1\nmain.lox;main.lox:3 2\n");
+        }
+
+        TEST(LineSampler, SamplesVM)
+        {
+            auto sampler = LineSampler{std::chrono::microseconds{50}};
+            auto vm = VM{};
+            vm.set_line_sampler(&sampler);
+            const auto program = compile("var n = 0;\nwhile (n < 200000)\n  n = n + 1;\n");
+            {
+                const auto session = LineSampler::Session{&sampler};
+                vm.execute(program);
+            }
+            EXPECT_GT(sampler.total_samples(), 0);
+            EXPECT_EQ(sampler.samples(2) + sampler.samples(3), sampler.total_samples());
+        }
+
+#if defined(__unix__) || defined(__APPLE__)
+        void host_profiling_handler(int)
+        {
+        }
+
+        TEST(LineSampler, OneSamplerAtATime)
+        {
+            struct sigaction host = {};
+            host.sa_handler = host_profiling_handler;
+            sigemptyset(&host.sa_mask);
+            struct sigaction original = {};
+            ::sigaction(SIGPROF, &host, &original);
+
+            auto first = LineSampler{};
+            auto second = LineSampler{};
+            ASSERT_TRUE(first.start());
+            EXPECT_FALSE(second.start());
+            {
+                const auto session = LineSampler::Session{&second};
+                EXPECT_FALSE(session.sampling());
+            }
+            first.stop();
+            EXPECT_TRUE(second.start());
+            second.stop();
+
+            struct sigaction restored = {};
+            ::sigaction(SIGPROF, &original, &restored);
+            EXPECT_EQ(restored.sa_handler, &host_profiling_handler);
+        }
+#endif
+    } // namespace
+} // namespace lox
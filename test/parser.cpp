@@ -0,0 +1,67 @@
+#include "parser.h"
+
+#include "lexer.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace lox
+{
+    namespace
+    {
+        std::vector<std::string> parse_errors(const char* source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto result = parser.parse();
+            std::vector<std::string> errors;
+            if (!result) {
+                for (const auto& error : result.error()) {
+                    errors.emplace_back(error.what());
+                }
+            }
+            return errors;
+        }
+
+        TEST(Parser, ValidSource)
+        {
+            auto lexer = Lexer{"var a = 1; { print a; } fun f(x) { return x; }"};
+            auto parser = Parser{lexer};
+            const auto result = parser.parse();
+            ASSERT_TRUE(result.has_value());
+            EXPECT_EQ(result->roots().size(), 3);
+        }
+
+        TEST(Parser, RecoversAfterEachError)
+        {
+            const auto errors = parse_errors("var = 1;\nprint 1 +;\n{ var a = (1; }\nprint 2;\nvar b = 1 2;\n");
+            const auto expected = std::vector<std::string>{
+                "[1:5] Error: expected variable name",
+                "[2:10] Error: expected expression",
+                "[3:13] Error: missing closing )",
+                "[3:15] Error: expected expression", // Synchronizing stops before the block's '}'
+                "[5:11] Error: expected ';' after variable declaration",
+            };
+            EXPECT_EQ(errors, expected);
+        }
+
+        TEST(Parser, SkipsInvalidInput)
+        {
+            const auto errors = parse_errors("var a = 1 # ;\nprint a;\nprint \"unterminated");
+            const auto expected = std::vector<std::string>{
+                "[1:12] Error: Unexpected character",
+                "[3:20] Error: Unterminated string",
+            };
+            EXPECT_EQ(errors, expected);
+        }
+
+        TEST(Parser, NumberOutOfRange)
+        {
+            const auto errors = parse_errors(("print " + std::string(400, '9') + ";").c_str());
+            ASSERT_EQ(errors.size(), 1);
+            EXPECT_EQ(errors.front(), "[1:407] Error: number literal value is out of range");
+        }
+    } // namespace
+} // namespace lox
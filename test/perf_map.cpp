@@ -0,0 +1,51 @@
+#include "perf_map.h"
+
+#include "bytecode_compiler.h"
+#include "error.h"
+#include "lexer.h"
+#include "parser.h"
+#include "source_file.h"
+#include "vm.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string_view>
+
+namespace lox
+{
+    namespace
+    {
+        CompileOutput compile(const char* source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto statements = parser.parse();
+            EXPECT_TRUE(statements.has_value());
+            auto compiler = BytecodeCompiler{};
+            auto output = compiler.compile(*statements);
+            EXPECT_TRUE(output.has_value());
+            return *output;
+        }
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+        TEST(PerfMap, RunsProgramsBelowNamedTrampolines)
+        {
+            auto perf_map = PerfMap::create();
+            ASSERT_TRUE(perf_map.has_value());
+            auto vm = VM{};
+            (*perf_map)->run("lox::first", [&] { vm.execute(compile("var a = 1;")); });
+            (*perf_map)->run("lox::first", [&] { vm.execute(compile("a = a + 1;")); });
+            EXPECT_THROW((*perf_map)->run("lox::second", [&] { vm.execute(compile("b = 1;")); }), LoxError);
+            EXPECT_EQ((*perf_map)->symbols(), 2);
+
+            auto file = SourceFile::open((*perf_map)->filename().c_str());
+            ASSERT_TRUE(file.has_value());
+            const auto text = file->text();
+            EXPECT_NE(text.find(" lox::first\n"), std::string_view::npos);
+            EXPECT_NE(text.find(" lox::second\n"), std::string_view::npos);
+            std::filesystem::remove((*perf_map)->filename());
+        }
+#endif
+    } // namespace
+} // namespace lox
@@ -0,0 +1,58 @@
+#include "phase_timings.h"
+
+#include "allocation_counter.h"
+#include "lox.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace lox
+{
+    namespace
+    {
+        void run(PhaseTimings& timings, const char* source)
+        {
+            auto lox = Lox{};
+            lox.set_phase_timings(&timings);
+            testing::internal::CaptureStdout();
+            lox.run_string(source);
+            testing::internal::GetCapturedStdout();
+        }
+
+        TEST(PhaseTimings, CountsWork)
+        {
+            auto timings = PhaseTimings{};
+            run(timings, "var a = 1;\nprint a + 2;");
+
+            EXPECT_EQ(timings[Phase::Lex].items, 10);
+            EXPECT_EQ(timings[Phase::Parse].items, 6);
+            EXPECT_EQ(timings[Phase::Compile].items, 6);
+            // No loops, so no checkpoints
+            EXPECT_EQ(timings[Phase::Execute].items, 0);
+            EXPECT_GT(timings.total_duration().count(), 0);
+            // Allocations aren't measured without a counter
+            EXPECT_EQ(timings[Phase::Parse].allocated_bytes, 0);
+            EXPECT_NE(timings.report().find("parse includes lexing"), std::string::npos);
+        }
+
+        TEST(PhaseTimings, CountsCheckpoints)
+        {
+            auto timings = PhaseTimings{};
+            run(timings, "var i = 0;\nwhile (i < 3) i = i + 1;");
+            EXPECT_EQ(timings[Phase::Execute].items, 3);
+        }
+
+        TEST(PhaseTimings, CountsAllocations)
+        {
+            auto timings = PhaseTimings{&thread_allocated_bytes};
+            run(timings, "var a = 1;\nprint a + 2;");
+            EXPECT_GT(timings[Phase::Parse].allocated_bytes, 0);
+
+            const auto before = thread_allocated_bytes();
+            const auto buffer = std::make_unique<char[]>(100);
+            EXPECT_GE(thread_allocated_bytes() - before, 100);
+        }
+    } // namespace
+} // namespace lox
@@ -0,0 +1,49 @@
+#include "source_file.h"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace lox
+{
+    namespace
+    {
+        std::filesystem::path write_temp_file(const char* name, const std::string& contents)
+        {
+            const auto path = std::filesystem::temp_directory_path() / name;
+            std::ofstream{path, std::ios::binary} << contents;
+            return path;
+        }
+
+        TEST(SourceFile, MapsRegularFile)
+        {
+            const auto contents = std::string{"var a = 1;\nprint a;\n"};
+            const auto path = write_temp_file("lox_source_file_test.lox", contents);
+            auto source = SourceFile::open(path.string().c_str());
+            ASSERT_TRUE(source.has_value());
+            EXPECT_EQ(source->text(), contents);
+
+            auto moved = std::move(*source);
+            EXPECT_EQ(moved.text(), contents);
+            std::filesystem::remove(path);
+        }
+
+        TEST(SourceFile, EmptyFile)
+        {
+            const auto path = write_temp_file("lox_source_file_empty.lox", "");
+            const auto source = SourceFile::open(path.string().c_str());
+            ASSERT_TRUE(source.has_value());
+            EXPECT_TRUE(source->text().empty());
+            std::filesystem::remove(path);
+        }
+
+        TEST(SourceFile, MissingFile)
+        {
+            const auto source = SourceFile::open("lox_source_file_missing.lox");
+            ASSERT_FALSE(source.has_value());
+            EXPECT_TRUE(source.error().starts_with("lox_source_file_missing.lox: "));
+        }
+    } // namespace
+} // namespace lox
@@ -0,0 +1,97 @@
+#include "trace.h"
+
+#include "bytecode_compiler.h"
+#include "error.h"
+#include "lexer.h"
+#include "lox_number.h"
+#include "parser.h"
+#include "vm.h"
+
+#include <fmt/format.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace lox
+{
+    namespace
+    {
+        CompileOutput compile(const char* source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto statements = parser.parse();
+            EXPECT_TRUE(statements.has_value());
+            auto compiler = BytecodeCompiler{};
+            auto output = compiler.compile(*statements);
+            EXPECT_TRUE(output.has_value());
+            return *output;
+        }
+
+        // Unique per run, tests from several build trees share the temp directory
+        std::string temp_trace_path(std::string_view name)
+        {
+            const auto suffix = std::chrono::steady_clock::now().time_since_epoch().count();
+            return (std::filesystem::temp_directory_path() / fmt::format("lox_{}_{}.trace", name, suffix)).string();
+        }
+
+        TEST(Trace, RecordAndReplay)
+        {
+            const auto path = temp_trace_path("record");
+            // Enough branches to span more than one segment
+            const auto program = compile("var n = 0; while (n < 270000) { if (n == 5 or n == 7) print n; n = n + 1; }");
+            {
+                auto recorder = TraceRecorder::create(path.c_str());
+                ASSERT_TRUE(recorder.has_value());
+                auto vm = VM{};
+                vm.set_branch_observer(recorder->get());
+                vm.execute(program);
+                vm.execute(compile("if (true) print 1;"));
+                (*recorder)->finish();
+                EXPECT_GT((*recorder)->recorded(), TraceRecorder::segment_records);
+                EXPECT_EQ((*recorder)->dropped(), 0);
+            }
+
+            auto replayer = TraceReplayer::open(path.c_str());
+            ASSERT_TRUE(replayer.has_value());
+            auto vm = VM{};
+            vm.set_branch_observer(&*replayer);
+            EXPECT_NO_THROW(vm.execute(program));
+            EXPECT_FALSE(replayer->at_end());
+            EXPECT_THROW(vm.execute(compile("if (false) print 1;")), LoxError);
+            std::filesystem::remove(path);
+        }
+
+        TEST(Trace, ReplayDetectsDivergence)
+        {
+            const auto path = temp_trace_path("divergence");
+            const auto program = compile("var n = 0; while (n < 3) { if (native) print n; n = n + 1; }");
+            {
+                auto recorder = TraceRecorder::create(path.c_str());
+                ASSERT_TRUE(recorder.has_value());
+                auto vm = VM{};
+                vm.define_native("native", std::make_shared<LoxNumber>(1));
+                vm.set_branch_observer(recorder->get());
+                vm.execute(program);
+            }
+
+            auto replayer = TraceReplayer::open(path.c_str());
+            ASSERT_TRUE(replayer.has_value());
+            auto vm = VM{};
+            vm.define_native("native", std::make_shared<LoxNumber>(0));
+            vm.set_branch_observer(&*replayer);
+            try {
+                vm.execute(program);
+                FAIL() << "expected the replay to diverge";
+            } catch (const LoxError& error) {
+                EXPECT_NE(std::string_view{error.what()}.find("replay diverged"), std::string_view::npos);
+            }
+            EXPECT_EQ(replayer->verified(), 1);
+            std::filesystem::remove(path);
+        }
+    } // namespace
+} // namespace lox
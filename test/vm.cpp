@@ -0,0 +1,234 @@
+#include "vm.h"
+
+#include "bytecode_compiler.h"
+#include "error.h"
+#include "execution_task.h"
+#include "lexer.h"
+#include "lox.h"
+#include "lox_nil.h"
+#include "lox_number.h"
+#include "op_profiler.h"
+#include "parser.h"
+#include "vm_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string_view>
+
+namespace lox
+{
+    namespace
+    {
+        CompileOutput compile(const char* source)
+        {
+            auto lexer = Lexer{source};
+            auto parser = Parser{lexer};
+            const auto statements = parser.parse();
+            EXPECT_TRUE(statements.has_value());
+            auto compiler = BytecodeCompiler{};
+            auto output = compiler.compile(*statements);
+            EXPECT_TRUE(output.has_value());
+            return *output;
+        }
+
+        TEST(VM, ResetClearsGlobals)
+        {
+            auto vm = VM{};
+            vm.execute(compile("var a = 1;"));
+            EXPECT_NO_THROW(vm.execute(compile("a = a + 1;")));
+            vm.reset();
+            EXPECT_THROW(vm.execute(compile("a = 1;")), LoxError);
+        }
+
+        TEST(VM, ResetKeepsNatives)
+        {
+            auto vm = VM{};
+            vm.define_native("answer", std::make_shared<LoxNumber>(42));
+            vm.execute(compile("answer = nil;"));
+            vm.reset();
+            EXPECT_NO_THROW(vm.execute(compile("var a = answer + 1;")));
+        }
+
+        // Line reported for the error raised by `source`, 0 if none was raised
+        std::int32_t error_line(const CompileOutput& program)
+        {
+            auto vm = VM{};
+            try {
+                vm.execute(program);
+            } catch (const LoxError& error) {
+                return error.location().line;
+            }
+            return 0;
+        }
+
+        TEST(VM, RuntimeErrorLocation)
+        {
+            EXPECT_EQ(error_line(compile("var a = 1;\n\nprint a / 0;")), 3);
+            EXPECT_EQ(error_line(compile("var a = 1;\nprint a;\nprint b;")), 3);
+            EXPECT_EQ(error_line(compile("var a = 1;\nwhile (a < 3)\n  a = a + nil;")), 3);
+            EXPECT_EQ(error_line(compile("print -\n\"s\";")), 1);
+
+            auto vm = VM{};
+            try {
+                vm.execute(compile("var a = 1;\nprint a + true;"));
+                FAIL() << "expected a LoxError";
+            } catch (const LoxError& error) {
+                EXPECT_TRUE(std::string_view{error.what()}.starts_with("[2] Error: unsupported binary operation"));
+            }
+        }
+
+        TEST(VM, StackOverflow)
+        {
+            auto vm = VM{4};
+            EXPECT_THROW(vm.execute(compile("var a = 1 + (2 + (3 + (4 + 5)));")), LoxError);
+            EXPECT_NO_THROW(vm.execute(compile("var a = 1 + (2 + (3 + 4));")));
+        }
+
+        TEST(VM, HostPushPastCapacity)
+        {
+            auto vm = VM{2};
+            vm.push(LoxNil::nil_ref());
+            vm.push(LoxNil::nil_ref());
+            EXPECT_THROW(vm.push(LoxNil::nil_ref()), LoxError);
+        }
+
+        TEST(VM, ExactStackSize)
+        {
+            const auto program = compile(R"(
+                var a = 0;
+                for (var i = 0; i < 3; i = i + 1) {
+                    var b = i * (2 + (3 - a));
+                    if (b > 2 and !(b == 4)) { a = a + b; } else { var c = -b; a = a - c; }
+                }
+            )");
+            auto vm = VM{program.max_stack_depth};
+            EXPECT_NO_THROW(vm.execute(program));
+        }
+
+        TEST(VM, BudgetExhausted)
+        {
+            const auto program = compile("while (true) {}");
+            auto vm = VM{};
+            EXPECT_EQ(vm.execute(program, 100), ExecutionStatus::BudgetExhausted);
+            EXPECT_TRUE(vm.is_suspended());
+            EXPECT_EQ(vm.resume(100), ExecutionStatus::BudgetExhausted);
+            vm.reset();
+            EXPECT_FALSE(vm.is_suspended());
+        }
+
+        TEST(VM, ResumeAfterBudgetExhausted)
+        {
+            const auto program = compile("var n = 0; for (var i = 0; i < 10; i = i + 1) { n = n + 1; }");
+            auto vm = VM{};
+            EXPECT_EQ(vm.execute(program, 4), ExecutionStatus::BudgetExhausted);
+            EXPECT_EQ(vm.resume(4), ExecutionStatus::BudgetExhausted);
+            EXPECT_EQ(vm.resume(4), ExecutionStatus::Completed);
+            EXPECT_FALSE(vm.is_suspended());
+            EXPECT_NO_THROW(vm.execute(compile("n = n + 1;")));
+        }
+
+        TEST(VM, ExecuteAsync)
+        {
+            const auto program = compile("var n = 0; for (var i = 0; i < 10; i = i + 1) { n = n + 1; }");
+            auto vm = VM{};
+            auto task = vm.execute_async(program, 4);
+            int slices = 0;
+            while (task.resume()) {
+                EXPECT_EQ(task.status(), ExecutionStatus::BudgetExhausted);
+                ++slices;
+            }
+            EXPECT_EQ(slices, 2);
+            EXPECT_TRUE(task.done());
+            EXPECT_EQ(task.status(), ExecutionStatus::Completed);
+        }
+
+        TEST(VM, ExecuteAsyncRequestSuspend)
+        {
+            const auto program = compile("while (true) {}");
+            auto vm = VM{};
+            auto task = vm.execute_async(program);
+            vm.request_suspend();
+            EXPECT_TRUE(task.resume());
+            EXPECT_EQ(task.status(), ExecutionStatus::Suspended);
+        }
+
+        TEST(VM, SuspendRequestDroppedOnCompletion)
+        {
+            auto vm = VM{};
+            // Made while a script without checkpoints runs
+            vm.request_suspend();
+            EXPECT_EQ(vm.execute(compile("var a = 1;")), ExecutionStatus::Completed);
+            EXPECT_EQ(vm.execute(compile("var n = 0; while (n < 3) n = n + 1;")), ExecutionStatus::Completed);
+        }
+
+        TEST(VM, ExecuteAsyncError)
+        {
+            const auto program = compile("var a = 1; var b = a + true;");
+            auto vm = VM{};
+            auto task = vm.execute_async(program);
+            EXPECT_THROW(task.resume(), LoxError);
+            EXPECT_TRUE(task.done());
+        }
+
+        TEST(VMPool, ReusesReleasedVM)
+        {
+            auto pool = VMPool{1};
+            const VM* first = nullptr;
+            {
+                auto vm = pool.acquire();
+                first = vm.get();
+                vm->execute(compile("var a = 1;"));
+                EXPECT_EQ(pool.idle_count(), 0);
+            }
+            EXPECT_EQ(pool.idle_count(), 1);
+
+            auto vm = pool.acquire();
+            EXPECT_EQ(vm.get(), first);
+            EXPECT_THROW(vm->execute(compile("a = 2;")), LoxError);
+        }
+
+        TEST(VMPool, GrowsWhenExhausted)
+        {
+            auto pool = VMPool{1};
+            pool.define_native("answer", std::make_shared<LoxNumber>(42));
+            auto first = pool.acquire();
+            auto second = pool.acquire();
+            EXPECT_NE(first.get(), second.get());
+            EXPECT_NO_THROW(second->execute(compile("var a = answer;")));
+        }
+
+        TEST(OpProfiler, CountsInstructionsAndPairs)
+        {
+            auto profiler = OpProfiler{};
+            for (const auto op : {Instruction::GetLocal, Instruction::GetLocal, Instruction::Add, Instruction::Pop}) {
+                profiler.begin(op);
+            }
+            profiler.end();
+            profiler.begin(Instruction::GetLocal);
+            profiler.end();
+
+            EXPECT_EQ(profiler.count(Instruction::GetLocal), 3);
+            EXPECT_EQ(profiler.count(Instruction::Add), 1);
+            EXPECT_EQ(profiler.count(Instruction::Sub), 0);
+            EXPECT_EQ(profiler.pair_count(Instruction::GetLocal, Instruction::GetLocal), 1);
+            EXPECT_EQ(profiler.pair_count(Instruction::GetLocal, Instruction::Add), 1);
+            // end() breaks the chain, the last get_local doesn't follow pop
+            EXPECT_EQ(profiler.pair_count(Instruction::Pop, Instruction::GetLocal), 0);
+            EXPECT_NE(profiler.report().find("get_local -> add"), std::string::npos);
+
+            profiler.clear();
+            EXPECT_EQ(profiler.count(Instruction::GetLocal), 0);
+        }
+
+#if defined(LOX_PROFILE_OPS)
+        TEST(OpProfiler, ProfilesVM)
+        {
+            auto vm = VM{};
+            vm.execute(compile("var n = 0; for (var i = 0; i < 10; i = i + 1) { n = n + 1; }"));
+            EXPECT_EQ(vm.op_profile().count(Instruction::JmpSigned), 10);
+            EXPECT_EQ(vm.op_profile().count(Instruction::DefineGlobal), 1);
+        }
+#endif
+    } // namespace
+} // namespace lox